@@ -1,5 +1,11 @@
 #include <bits/stdc++.h>
 #include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -63,16 +69,29 @@ private:
     string name;
     int yoe;
     string description;
+
+public:
+    Skill(string skillName, int years, string desc) : name(skillName), yoe(years), description(desc) {}
+
+    const string& getName() const { return name; }
 };
 
 class Experience {
 private:
     string name;
-    time_t start_time;
-    time_t end_time;
+    time_t start_time = 0;
+    time_t end_time = 0;
     string designation;
     string company_name;
     string company_id;
+
+public:
+    Experience(string title, string role, string companyName, string companyId)
+        : name(title), designation(role), company_name(companyName), company_id(companyId) {}
+
+    const string& getName() const { return name; }
+    const string& getDesignation() const { return designation; }
+    const string& getCompanyName() const { return company_name; }
 };
 
 class Comment {
@@ -102,6 +121,18 @@ private:
     time_t dop;
     string title;
     string description;
+    string location;
+
+public:
+    JobPosting(int pid, string jobTitle, string desc, string city)
+        : post_id(pid), title(jobTitle), description(desc), location(city) {
+        dop = time(nullptr);
+    }
+
+    int getPostId() const { return post_id; }
+    const string& getTitle() const { return title; }
+    const string& getDescription() const { return description; }
+    const string& getLocation() const { return location; }
 };
 
 class Recommendation {
@@ -164,6 +195,273 @@ public:
     }
 };
 
+// MESSAGING
+
+struct StoredMessage {
+    uint64_t seq;  // position in the conversation, increasing with time
+    time_t timestamp;
+    int senderId;
+    string text;
+};
+
+// Pages run newest first; a cursor asks for the messages strictly older than it
+struct MessageCursor {
+    time_t timestamp = numeric_limits<time_t>::max();
+    uint64_t seq = UINT64_MAX;
+};
+
+struct MessagePage {
+    vector<StoredMessage> messages;
+    MessageCursor next;  // pass back for the following page
+    bool hasMore = false;
+};
+
+struct ConversationSummary {
+    int otherUserId;
+    time_t lastActivity;
+    uint32_t unread;
+};
+
+// Messages stored per conversation in append-only chunks of kChunkMessages. Each chunk
+// keeps its records and texts back to back, and a conversation indexes its chunks by
+// time, so a page is a binary search plus one step per message. Beyond kResidentChunks
+// sealed chunks per conversation, the oldest are written to a spill file and read back
+// through mmap when a page reaches them, which bounds memory for heavy users.
+class MessageStore {
+private:
+    static constexpr uint32_t kChunkMessages = 64;
+    static constexpr size_t kResidentChunks = 4;
+
+    struct Record {
+        int64_t timestamp;
+        uint64_t seq;
+        int32_t senderId;
+        uint32_t textLength;
+    };
+
+    struct Chunk {
+        vector<Record> records;
+        string text;  // record texts back to back, in record order
+    };
+
+    struct ChunkInfo {
+        int64_t lastTimestamp;
+        uint64_t lastSeq;
+        uint32_t count;
+        unique_ptr<Chunk> resident;  // null once spilled
+        uint64_t fileOffset;
+        uint64_t fileBytes;
+    };
+
+    struct Conversation {
+        mutex lock;
+        int users[2];
+        vector<ChunkInfo> chunks;
+        size_t firstResident = 0;  // chunks before this one are in the spill file
+        uint64_t nextSeq = 0;
+        int64_t lastTimestamp = 0;
+        uint32_t unread[2] = {0, 0};
+    };
+
+    shared_mutex lock;  // guards the maps; each conversation has its own lock
+    unordered_map<uint64_t, unique_ptr<Conversation>> conversations;
+    unordered_map<int, vector<uint64_t>> conversationsByUser;
+    int spillFd = -1;
+    atomic<uint64_t> spillBytes{0};
+
+    static uint64_t keyOf(int a, int b) {
+        if (a > b) swap(a, b);
+        return (uint64_t)(uint32_t)a << 32 | (uint32_t)b;
+    }
+
+    static bool olderThan(int64_t timestamp, uint64_t seq, const MessageCursor& cursor) {
+        return timestamp != cursor.timestamp ? timestamp < cursor.timestamp : seq < cursor.seq;
+    }
+
+    Conversation* find(int a, int b) {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = conversations.find(keyOf(a, b));
+        return it == conversations.end() ? nullptr : it->second.get();
+    }
+
+    Conversation* findOrCreate(int a, int b) {
+        if (Conversation* conversation = find(a, b)) return conversation;
+        unique_lock<shared_mutex> guard(lock);
+        auto& slot = conversations[keyOf(a, b)];
+        if (!slot) {
+            slot = make_unique<Conversation>();
+            slot->users[0] = min(a, b);
+            slot->users[1] = max(a, b);
+            conversationsByUser[a].push_back(keyOf(a, b));
+            if (a != b) conversationsByUser[b].push_back(keyOf(a, b));
+        }
+        return slot.get();
+    }
+
+    // Writes the oldest resident sealed chunk to the spill file. Caller holds the conversation lock.
+    void spillOldest(Conversation& conversation) {
+        ChunkInfo& info = conversation.chunks[conversation.firstResident];
+        const Chunk& chunk = *info.resident;
+        uint64_t recordBytes = chunk.records.size() * sizeof(Record);
+        uint64_t bytes = recordBytes + chunk.text.size();
+        uint64_t offset = spillBytes.fetch_add(bytes);
+        if (pwrite(spillFd, chunk.records.data(), recordBytes, offset) != (ssize_t)recordBytes ||
+            pwrite(spillFd, chunk.text.data(), chunk.text.size(), offset + recordBytes) != (ssize_t)chunk.text.size()) {
+            return;  // keep it in memory rather than lose it
+        }
+        info.fileOffset = offset;
+        info.fileBytes = bytes;
+        info.resident.reset();
+        conversation.firstResident++;
+    }
+
+    // Maps a spilled chunk back in and copies it out
+    bool loadSpilled(const ChunkInfo& info, Chunk& chunk) {
+        long page = sysconf(_SC_PAGESIZE);
+        uint64_t start = info.fileOffset / page * page;
+        size_t length = info.fileOffset + info.fileBytes - start;
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, spillFd, start);
+        if (mapped == MAP_FAILED) return false;
+        const char* data = static_cast<const char*>(mapped) + (info.fileOffset - start);
+        const Record* records = reinterpret_cast<const Record*>(data);
+        chunk.records.assign(records, records + info.count);
+        chunk.text.assign(data + info.count * sizeof(Record), info.fileBytes - info.count * sizeof(Record));
+        munmap(mapped, length);
+        return true;
+    }
+
+public:
+    ~MessageStore() {
+        if (spillFd >= 0) close(spillFd);
+    }
+
+    // Enables spilling of old chunks to `path`. Without it every chunk stays in memory.
+    bool openSpill(const string& path) {
+        spillFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        return spillFd >= 0;
+    }
+
+    void append(int senderId, int receiverId, const string& text) {
+        Conversation& conversation = *findOrCreate(senderId, receiverId);
+        lock_guard<mutex> guard(conversation.lock);
+        // Never older than the last message, so chunks stay sorted by (timestamp, seq)
+        int64_t now = max<int64_t>(time(nullptr), conversation.lastTimestamp);
+        if (conversation.chunks.empty() || conversation.chunks.back().count == kChunkMessages) {
+            conversation.chunks.push_back({0, 0, 0, make_unique<Chunk>(), 0, 0});
+            if (spillFd >= 0 && conversation.chunks.size() - conversation.firstResident > kResidentChunks + 1) {
+                spillOldest(conversation);
+            }
+        }
+        ChunkInfo& info = conversation.chunks.back();
+        uint64_t seq = conversation.nextSeq++;
+        info.resident->records.push_back({now, seq, senderId, (uint32_t)text.size()});
+        info.resident->text += text;
+        info.count++;
+        info.lastTimestamp = now;
+        info.lastSeq = seq;
+        conversation.lastTimestamp = now;
+        if (receiverId != senderId) conversation.unread[receiverId == conversation.users[0] ? 0 : 1]++;
+    }
+
+    // Up to `limit` messages between the two users older than `before`, newest first
+    MessagePage getMessages(int userId, int otherUserId, size_t limit, MessageCursor before = MessageCursor()) {
+        MessagePage page;
+        Conversation* conversation = find(userId, otherUserId);
+        if (!conversation || limit == 0) return page;
+        lock_guard<mutex> guard(conversation->lock);
+        vector<ChunkInfo>& chunks = conversation->chunks;
+        if (chunks.empty()) return page;
+
+        // First chunk whose last message is not older than the cursor
+        size_t c = partition_point(chunks.begin(), chunks.end(), [&](const ChunkInfo& info) {
+            return olderThan(info.lastTimestamp, info.lastSeq, before);
+        }) - chunks.begin();
+        if (c == chunks.size()) c--;
+
+        Chunk loaded;
+        for (;; c--) {
+            const Chunk* chunk = chunks[c].resident.get();
+            if (!chunk) {
+                if (!loadSpilled(chunks[c], loaded)) break;
+                chunk = &loaded;
+            }
+            // Text offsets are cumulative, so walk forward once to find where each record starts
+            size_t end = partition_point(chunk->records.begin(), chunk->records.end(), [&](const Record& r) {
+                return olderThan(r.timestamp, r.seq, before);
+            }) - chunk->records.begin();
+            size_t textEnd = 0;
+            for (size_t i = 0; i < end; i++) textEnd += chunk->records[i].textLength;
+            size_t i = end;
+            for (; i > 0 && page.messages.size() < limit; i--) {
+                const Record& r = chunk->records[i - 1];
+                textEnd -= r.textLength;
+                page.messages.push_back({r.seq, (time_t)r.timestamp, r.senderId, chunk->text.substr(textEnd, r.textLength)});
+            }
+            if (page.messages.size() == limit) {
+                // A full page has more only if an older message is left, here or in an earlier chunk
+                page.hasMore = i > 0 || any_of(chunks.begin(), chunks.begin() + c,
+                                               [](const ChunkInfo& info) { return info.count > 0; });
+                break;
+            }
+            if (c == 0) break;
+        }
+        if (!page.messages.empty()) page.next = {page.messages.back().timestamp, page.messages.back().seq};
+        return page;
+    }
+
+    void markRead(int userId, int otherUserId) {
+        Conversation* conversation = find(userId, otherUserId);
+        if (!conversation) return;
+        lock_guard<mutex> guard(conversation->lock);
+        conversation->unread[userId == conversation->users[0] ? 0 : 1] = 0;
+    }
+
+    uint32_t getUnreadCount(int userId, int otherUserId) {
+        Conversation* conversation = find(userId, otherUserId);
+        if (!conversation) return 0;
+        lock_guard<mutex> guard(conversation->lock);
+        return conversation->unread[userId == conversation->users[0] ? 0 : 1];
+    }
+
+    // The user's conversations, most recently active first
+    vector<ConversationSummary> listConversations(int userId) {
+        vector<pair<uint64_t, Conversation*>> mine;
+        {
+            shared_lock<shared_mutex> guard(lock);
+            auto it = conversationsByUser.find(userId);
+            if (it == conversationsByUser.end()) return {};
+            for (uint64_t key : it->second) mine.push_back({key, conversations.at(key).get()});
+        }
+        vector<ConversationSummary> result;
+        for (auto& entry : mine) {
+            Conversation& conversation = *entry.second;
+            lock_guard<mutex> guard(conversation.lock);
+            int side = userId == conversation.users[0] ? 0 : 1;
+            result.push_back({conversation.users[1 - side], (time_t)conversation.lastTimestamp, conversation.unread[side]});
+        }
+        sort(result.begin(), result.end(), [](const ConversationSummary& a, const ConversationSummary& b) {
+            return a.lastActivity > b.lastActivity;
+        });
+        return result;
+    }
+};
+
+class MessageService {
+private:
+    static MessageStore* store;
+
+public:
+    static void setStore(MessageStore* newStore) {
+        store = newStore;
+    }
+
+    static void send(int senderId, int receiverId, const string& text) {
+        if (store) store->append(senderId, receiverId, text);
+    }
+};
+
+MessageStore* MessageService::store = nullptr;
+
 class ConnectionRequest {
 private:
     int fromUserId;
@@ -173,6 +471,8 @@ private:
 public:
     ConnectionRequest(int fromId, int toId) : fromUserId(fromId), toUserId(toId), accepted(false) {}
 
+    int getFromUserId() const { return fromUserId; }
+    int getToUserId() const { return toUserId; }
     void accept() { accepted = true; }
     void decline() { accepted = false; }
     bool isAccepted() const { return accepted; }
@@ -194,10 +494,21 @@ private:
     vector<Recommendation*> recommendations;
     vector<Company*> followingCompanies;
     vector<User*> followingUsers;
+    string location;
 
 public:
     void addEducation(Education* edu) { educations.push_back(edu); }
+    void addExperience(Experience* exp) { experiences.push_back(exp); }
+    void addFollowing(User* user) { followingUsers.push_back(user); }
+    void removeFollowing(User* user) {
+        followingUsers.erase(remove(followingUsers.begin(), followingUsers.end(), user), followingUsers.end());
+    }
     void addSkill(Skill* skill) { skills.push_back(skill); }
+    void setLocation(string city) { location = city; }
+
+    const vector<Experience*>& getExperiences() const { return experiences; }
+    const vector<Skill*>& getSkills() const { return skills; }
+    const string& getLocation() const { return location; }
     void addRecommendation(Recommendation* rec) { recommendations.push_back(rec); }
 };
 
@@ -205,15 +516,26 @@ public:
 
 class Post {
 private:
-    int post_id;
-    int user_id;
+    int post_id = 0;
+    int user_id = 0;
     string title;
     string body;
+    time_t timestamp = 0;
     vector<string> imageUrls;
     vector<Comment*> comments;
     vector<Reaction*> reactions;
 
 public:
+    Post() {}
+    Post(int pid, int uid, string postTitle, string postBody)
+        : post_id(pid), user_id(uid), title(postTitle), body(postBody) {
+        timestamp = time(nullptr);
+    }
+
+    int getPostId() { return post_id; }
+    int getUserId() { return user_id; }
+    time_t getTimestamp() { return timestamp; }
+
     void addComment(Comment* comment) {
         comments.push_back(comment);
         NotificationService::sendNotification(user_id, "New comment on your post.");
@@ -225,6 +547,966 @@ public:
     }
 };
 
+// SOCIAL GRAPH
+
+// One relation over dense node ids in compressed sparse row form: the neighbours of
+// node u are targets[offsets[u], offsets[u + 1]), sorted, at 4 bytes per edge. Recent
+// edits sit in small sorted per-node delta lists and are folded into the arrays by
+// compact() once they grow past a fraction of the graph.
+class CsrAdjacency {
+private:
+    vector<uint64_t> offsets{0};
+    vector<uint32_t> targets;
+    unordered_map<uint32_t, vector<uint32_t>> added;    // edges not yet in the arrays
+    unordered_map<uint32_t, vector<uint32_t>> removed;  // edges still in the arrays
+    size_t deltaSize = 0;
+    size_t edgeCount = 0;
+
+    static const vector<uint32_t>* deltaOf(const unordered_map<uint32_t, vector<uint32_t>>& delta, uint32_t u) {
+        auto it = delta.find(u);
+        return it == delta.end() ? nullptr : &it->second;
+    }
+
+    static bool contains(const vector<uint32_t>* list, uint32_t v) {
+        return list && binary_search(list->begin(), list->end(), v);
+    }
+
+    static void insertSorted(vector<uint32_t>& list, uint32_t v) {
+        list.insert(lower_bound(list.begin(), list.end(), v), v);
+    }
+
+    static void eraseSorted(unordered_map<uint32_t, vector<uint32_t>>& delta, uint32_t u, uint32_t v) {
+        vector<uint32_t>& list = delta[u];
+        list.erase(lower_bound(list.begin(), list.end(), v));
+        if (list.empty()) delta.erase(u);
+    }
+
+    bool inArrays(uint32_t u, uint32_t v) const {
+        auto r = row(u);
+        return binary_search(r.first, r.second, v);
+    }
+
+public:
+    // Neighbours in the arrays only; after compact() that is all of them
+    pair<const uint32_t*, const uint32_t*> row(uint32_t u) const {
+        if ((size_t)u + 1 >= offsets.size()) return {nullptr, nullptr};
+        return {targets.data() + offsets[u], targets.data() + offsets[u + 1]};
+    }
+
+    bool hasEdge(uint32_t u, uint32_t v) const {
+        if (inArrays(u, v)) return !contains(deltaOf(removed, u), v);
+        return contains(deltaOf(added, u), v);
+    }
+
+    bool addEdge(uint32_t u, uint32_t v) {
+        if (hasEdge(u, v)) return false;
+        if (inArrays(u, v)) {
+            eraseSorted(removed, u, v);
+            deltaSize--;
+        } else {
+            insertSorted(added[u], v);
+            deltaSize++;
+        }
+        edgeCount++;
+        return true;
+    }
+
+    bool removeEdge(uint32_t u, uint32_t v) {
+        if (!hasEdge(u, v)) return false;
+        if (inArrays(u, v)) {
+            insertSorted(removed[u], v);
+            deltaSize++;
+        } else {
+            eraseSorted(added, u, v);
+            deltaSize--;
+        }
+        edgeCount--;
+        return true;
+    }
+
+    size_t degree(uint32_t u) const {
+        auto r = row(u);
+        const vector<uint32_t>* plus = deltaOf(added, u);
+        const vector<uint32_t>* minus = deltaOf(removed, u);
+        return (r.second - r.first) + (plus ? plus->size() : 0) - (minus ? minus->size() : 0);
+    }
+
+    // Sorted neighbours of u, with the delta applied
+    void neighbors(uint32_t u, vector<uint32_t>& out) const {
+        out.clear();
+        auto r = row(u);
+        const vector<uint32_t>* plus = deltaOf(added, u);
+        const vector<uint32_t>* minus = deltaOf(removed, u);
+        if (!plus && !minus) {
+            out.assign(r.first, r.second);
+            return;
+        }
+        static const vector<uint32_t> none;
+        if (!plus) plus = &none;
+        if (!minus) minus = &none;
+        auto p = plus->begin();
+        auto m = minus->begin();
+        for (const uint32_t* t = r.first; t != r.second; t++) {
+            while (p != plus->end() && *p < *t) out.push_back(*p++);
+            while (m != minus->end() && *m < *t) m++;
+            if (m != minus->end() && *m == *t) continue;
+            out.push_back(*t);
+        }
+        out.insert(out.end(), p, plus->end());
+    }
+
+    size_t edges() const { return edgeCount; }
+
+    bool needsCompaction() const { return deltaSize > max<size_t>(4096, edgeCount / 8); }
+
+    // Folds the delta into fresh arrays sized for `nodes` nodes
+    void compact(uint32_t nodes) {
+        vector<uint64_t> newOffsets(nodes + 1, 0);
+        vector<uint32_t> newTargets;
+        newTargets.reserve(edgeCount);
+        vector<uint32_t> scratch;
+        for (uint32_t u = 0; u < nodes; u++) {
+            neighbors(u, scratch);
+            newTargets.insert(newTargets.end(), scratch.begin(), scratch.end());
+            newOffsets[u + 1] = newTargets.size();
+        }
+        offsets.swap(newOffsets);
+        targets.swap(newTargets);
+        added.clear();
+        removed.clear();
+        deltaSize = 0;
+    }
+};
+
+// Connections (undirected) and follows (directed) between users. User ids are mapped to
+// dense node ids in order of first appearance so every relation can be stored as CSR.
+class SocialGraph {
+private:
+    mutable shared_mutex lock;
+    unordered_map<int, uint32_t> denseIds;
+    vector<int> userIds;
+    CsrAdjacency connections;  // stored in both directions
+    CsrAdjacency following;    // follower -> followee
+    CsrAdjacency followers;    // followee -> follower
+
+    uint32_t nodeFor(int userId) {
+        auto it = denseIds.find(userId);
+        if (it != denseIds.end()) return it->second;
+        denseIds.emplace(userId, (uint32_t)userIds.size());
+        userIds.push_back(userId);
+        return (uint32_t)userIds.size() - 1;
+    }
+
+    bool findNode(int userId, uint32_t& node) const {
+        auto it = denseIds.find(userId);
+        if (it == denseIds.end()) return false;
+        node = it->second;
+        return true;
+    }
+
+    void compactIfNeeded(CsrAdjacency& relation) {
+        if (relation.needsCompaction()) relation.compact((uint32_t)userIds.size());
+    }
+
+    vector<int> neighborsOf(const CsrAdjacency& relation, int userId) const {
+        vector<int> result;
+        uint32_t node;
+        if (!findNode(userId, node)) return result;
+        vector<uint32_t> nodes;
+        relation.neighbors(node, nodes);
+        result.reserve(nodes.size());
+        for (uint32_t n : nodes) result.push_back(userIds[n]);
+        return result;
+    }
+
+    size_t degreeOf(const CsrAdjacency& relation, int userId) const {
+        uint32_t node;
+        return findNode(userId, node) ? relation.degree(node) : 0;
+    }
+
+public:
+    bool connect(int a, int b) {
+        if (a == b) return false;
+        unique_lock<shared_mutex> guard(lock);
+        uint32_t u = nodeFor(a), v = nodeFor(b);
+        if (!connections.addEdge(u, v)) return false;
+        connections.addEdge(v, u);
+        compactIfNeeded(connections);
+        return true;
+    }
+
+    bool disconnect(int a, int b) {
+        unique_lock<shared_mutex> guard(lock);
+        uint32_t u, v;
+        if (!findNode(a, u) || !findNode(b, v) || !connections.removeEdge(u, v)) return false;
+        connections.removeEdge(v, u);
+        compactIfNeeded(connections);
+        return true;
+    }
+
+    bool follow(int followerId, int followeeId) {
+        if (followerId == followeeId) return false;
+        unique_lock<shared_mutex> guard(lock);
+        uint32_t u = nodeFor(followerId), v = nodeFor(followeeId);
+        if (!following.addEdge(u, v)) return false;
+        followers.addEdge(v, u);
+        compactIfNeeded(following);
+        compactIfNeeded(followers);
+        return true;
+    }
+
+    bool unfollow(int followerId, int followeeId) {
+        unique_lock<shared_mutex> guard(lock);
+        uint32_t u, v;
+        if (!findNode(followerId, u) || !findNode(followeeId, v) || !following.removeEdge(u, v)) return false;
+        followers.removeEdge(v, u);
+        compactIfNeeded(following);
+        compactIfNeeded(followers);
+        return true;
+    }
+
+    bool isConnected(int a, int b) const {
+        shared_lock<shared_mutex> guard(lock);
+        uint32_t u, v;
+        return findNode(a, u) && findNode(b, v) && connections.hasEdge(u, v);
+    }
+
+    bool isFollowing(int followerId, int followeeId) const {
+        shared_lock<shared_mutex> guard(lock);
+        uint32_t u, v;
+        return findNode(followerId, u) && findNode(followeeId, v) && following.hasEdge(u, v);
+    }
+
+    vector<int> getConnections(int userId) const {
+        shared_lock<shared_mutex> guard(lock);
+        return neighborsOf(connections, userId);
+    }
+
+    vector<int> getFollowers(int userId) const {
+        shared_lock<shared_mutex> guard(lock);
+        return neighborsOf(followers, userId);
+    }
+
+    vector<int> getFollowing(int userId) const {
+        shared_lock<shared_mutex> guard(lock);
+        return neighborsOf(following, userId);
+    }
+
+    size_t connectionCount(int userId) const {
+        shared_lock<shared_mutex> guard(lock);
+        return degreeOf(connections, userId);
+    }
+
+    size_t followerCount(int userId) const {
+        shared_lock<shared_mutex> guard(lock);
+        return degreeOf(followers, userId);
+    }
+
+    // Dense-id view for graph jobs such as recommendations
+
+    bool nodeOf(int userId, uint32_t& node) const {
+        shared_lock<shared_mutex> guard(lock);
+        return findNode(userId, node);
+    }
+
+    int userIdOf(uint32_t node) const {
+        shared_lock<shared_mutex> guard(lock);
+        return userIds[node];
+    }
+
+    uint32_t nodeCount() const {
+        shared_lock<shared_mutex> guard(lock);
+        return (uint32_t)userIds.size();
+    }
+
+    void connectionsOf(uint32_t node, vector<uint32_t>& out) const {
+        shared_lock<shared_mutex> guard(lock);
+        connections.neighbors(node, out);
+    }
+
+    // Runs `scan` holding the read lock once, for traversals that touch many rows. The
+    // node count is read under the same lock, so it covers every node the rows mention.
+    void readConnections(const function<void(const CsrAdjacency&, uint32_t nodes)>& scan) const {
+        shared_lock<shared_mutex> guard(lock);
+        scan(connections, (uint32_t)userIds.size());
+    }
+
+    // Compacted copy of the connections, so batch jobs can scan rows without the lock
+    CsrAdjacency connectionSnapshot(uint32_t& nodes) const {
+        shared_lock<shared_mutex> guard(lock);
+        nodes = (uint32_t)userIds.size();
+        CsrAdjacency copy = connections;
+        copy.compact(nodes);
+        return copy;
+    }
+
+    // Connections a and b have in common. When one side is much larger, the smaller
+    // list is binary-searched into the larger one instead of merging both.
+    size_t mutualConnectionCount(int a, int b) const {
+        shared_lock<shared_mutex> guard(lock);
+        uint32_t u, v;
+        if (!findNode(a, u) || !findNode(b, v)) return 0;
+        vector<uint32_t> small, large;
+        connections.neighbors(u, small);
+        connections.neighbors(v, large);
+        if (small.size() > large.size()) small.swap(large);
+        size_t common = 0;
+        if (large.size() > 16 * small.size()) {
+            auto from = large.begin();
+            for (uint32_t n : small) {
+                from = lower_bound(from, large.end(), n);
+                if (from == large.end()) break;
+                if (*from == n) common++;
+            }
+        } else {
+            auto i = small.begin();
+            auto j = large.begin();
+            while (i != small.end() && j != large.end()) {
+                if (*i < *j) i++;
+                else if (*j < *i) j++;
+                else { common++; i++; j++; }
+            }
+        }
+        return common;
+    }
+};
+
+// RECOMMENDATIONS
+
+// Size of the intersection of two sorted id lists. With SSE2 each step compares a block
+// of four ids against all four rotations of a block of the other list, then advances the
+// block with the smaller maximum; the tails are merged one by one.
+static size_t intersectionSize(const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+    size_t i = 0, j = 0, count = 0;
+#ifdef __SSE2__
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(match)));
+        uint32_t lastA = a[i + 3], lastB = b[j + 3];
+        if (lastA <= lastB) i += 4;
+        if (lastB <= lastA) j += 4;
+    }
+#endif
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (b[j] < a[i]) j++;
+        else { count++; i++; j++; }
+    }
+    return count;
+}
+
+// Runs tasks 0..n-1 on a fixed set of threads, started once and parked between runs;
+// the caller of run() works as worker 0. Each worker starts with a contiguous share of
+// the tasks and takes from the back of its own queue; when that runs dry it steals
+// from the front of another worker's, so a few expensive tasks don't leave the other
+// threads idle.
+class WorkStealingPool {
+private:
+    struct alignas(64) TaskQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    int workers;
+    vector<TaskQueue> queues;
+    vector<thread> helpers;  // workers 1..n-1
+
+    mutex runLock;  // one run at a time
+    mutex stateLock;
+    condition_variable wake, finished;
+    const function<void(size_t, int)>* current = nullptr;
+    uint64_t generation = 0;
+    int busy = 0;  // helpers still working on the current run
+    bool stopping = false;
+
+    static bool take(TaskQueue& queue, size_t& task, bool fromBack) {
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) return false;
+        if (fromBack) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+
+    void drain(int w, const function<void(size_t, int)>& task) {
+        size_t next;
+        while (true) {
+            bool found = take(queues[w], next, true);
+            for (int k = 1; !found && k < workers; k++) found = take(queues[(w + k) % workers], next, false);
+            if (!found) return;  // tasks never spawn tasks, so empty everywhere means done
+            task(next, w);
+        }
+    }
+
+    void helperLoop(int w) {
+        uint64_t seen = 0;
+        while (true) {
+            const function<void(size_t, int)>* task;
+            {
+                unique_lock<mutex> guard(stateLock);
+                wake.wait(guard, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                task = current;
+            }
+            drain(w, *task);
+            lock_guard<mutex> guard(stateLock);
+            if (--busy == 0) finished.notify_one();
+        }
+    }
+
+public:
+    WorkStealingPool(int threads) : workers(max(threads, 1)), queues(workers) {
+        for (int w = 1; w < workers; w++) helpers.emplace_back(&WorkStealingPool::helperLoop, this, w);
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(stateLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& t : helpers) t.join();
+    }
+
+    int size() const { return workers; }
+
+    // `task(index, worker)`; returns once every task has run. If another run holds the
+    // pool, the tasks run on the calling thread instead of queueing behind it.
+    void run(size_t taskCount, const function<void(size_t, int)>& task) {
+        unique_lock<mutex> exclusive(runLock, try_to_lock);
+        if (workers == 1 || taskCount <= 1 || !exclusive.owns_lock()) {
+            for (size_t t = 0; t < taskCount; t++) task(t, 0);
+            return;
+        }
+        // Every queue was drained by the previous run
+        for (size_t t = 0; t < taskCount; t++) {
+            TaskQueue& queue = queues[t * workers / taskCount];
+            lock_guard<mutex> guard(queue.lock);
+            queue.tasks.push_back(t);
+        }
+        {
+            lock_guard<mutex> guard(stateLock);
+            current = &task;
+            busy = workers - 1;
+            generation++;
+        }
+        wake.notify_all();
+        drain(0, task);
+        unique_lock<mutex> guard(stateLock);
+        finished.wait(guard, [&]() { return busy == 0; });
+    }
+};
+
+struct Suggestion {
+    int userId;
+    uint32_t mutualConnections;
+};
+
+// "People you may know": for each user, the second-degree connections they share the
+// most connections with. recomputeAll() rebuilds every list from a graph snapshot;
+// onConnectionAccepted() patches the lists of the two users involved and of the people
+// the new connection brought within two hops.
+class PeopleYouMayKnow {
+private:
+    struct Candidate {
+        uint32_t node;
+        uint32_t mutual;
+    };
+
+    static constexpr int kStripes = 64;
+    static constexpr uint32_t kUsersPerTask = 256;
+    // Connections of anyone above this are not expanded: they cost deg^2 and say little
+    static constexpr size_t kHubDegree = 5000;
+
+    SocialGraph* graph;
+    size_t topK;
+    WorkStealingPool pool;
+    shared_mutex resultsLock;  // exclusive only to swap or grow `results`
+    vector<vector<Candidate>> results;  // by dense node id
+    mutex stripes[kStripes];
+
+    static bool better(const Candidate& a, const Candidate& b) {
+        return a.mutual != b.mutual ? a.mutual > b.mutual : a.node < b.node;
+    }
+
+    // Inserts or refreshes a candidate, keeping the list sorted and at most topK long
+    void offer(vector<Candidate>& list, Candidate candidate) {
+        list.erase(remove_if(list.begin(), list.end(), [&](const Candidate& c) { return c.node == candidate.node; }), list.end());
+        if (candidate.mutual == 0) return;
+        list.insert(upper_bound(list.begin(), list.end(), candidate, better), candidate);
+        if (list.size() > topK) list.pop_back();
+    }
+
+    void ensureCapacity(uint32_t nodes) {
+        {
+            shared_lock<shared_mutex> guard(resultsLock);
+            if (results.size() >= nodes) return;
+        }
+        unique_lock<shared_mutex> guard(resultsLock);
+        if (results.size() < nodes) results.resize(nodes);
+    }
+
+    // Caller holds resultsLock shared
+    void update(uint32_t node, Candidate candidate) {
+        lock_guard<mutex> guard(stripes[node % kStripes]);
+        offer(results[node], candidate);
+    }
+
+public:
+    PeopleYouMayKnow(SocialGraph* socialGraph, size_t k = 20, int threads = (int)max(1u, thread::hardware_concurrency()))
+        : graph(socialGraph), topK(k), pool(threads) {}
+
+    void recomputeAll() {
+        uint32_t nodes;
+        CsrAdjacency snapshot = graph->connectionSnapshot(nodes);
+        vector<vector<Candidate>> fresh(nodes);
+
+        const uint32_t kExcluded = UINT32_MAX;
+        vector<vector<uint32_t>> counts(pool.size());
+        size_t tasks = (nodes + kUsersPerTask - 1) / kUsersPerTask;
+        pool.run(tasks, [&](size_t task, int worker) {
+            vector<uint32_t>& count = counts[worker];
+            if (count.size() < nodes) count.assign(nodes, 0);
+            vector<uint32_t> touched;
+            uint32_t end = min<uint32_t>(nodes, (task + 1) * kUsersPerTask);
+            for (uint32_t u = task * kUsersPerTask; u < end; u++) {
+                auto friends = snapshot.row(u);
+                count[u] = kExcluded;
+                for (const uint32_t* f = friends.first; f != friends.second; f++) count[*f] = kExcluded;
+                for (const uint32_t* f = friends.first; f != friends.second; f++) {
+                    auto second = snapshot.row(*f);
+                    if ((size_t)(second.second - second.first) > kHubDegree) continue;
+                    for (const uint32_t* w = second.first; w != second.second; w++) {
+                        if (count[*w] == kExcluded) continue;
+                        if (count[*w]++ == 0) touched.push_back(*w);
+                    }
+                }
+                vector<Candidate> candidates;
+                candidates.reserve(touched.size());
+                for (uint32_t w : touched) {
+                    candidates.push_back({w, count[w]});
+                    count[w] = 0;
+                }
+                size_t keep = min(topK, candidates.size());
+                partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(), better);
+                candidates.resize(keep);
+                fresh[u].swap(candidates);
+                touched.clear();
+                count[u] = 0;
+                for (const uint32_t* f = friends.first; f != friends.second; f++) count[*f] = 0;
+            }
+        });
+
+        unique_lock<shared_mutex> guard(resultsLock);
+        results.swap(fresh);
+    }
+
+    // Call after the connection is in the graph. Every friend of one side is now a
+    // second-degree contact of the other; their mutual counts are recomputed exactly
+    // by intersecting the two sorted connection lists.
+    void onConnectionAccepted(int a, int b) {
+        uint32_t u, v;
+        if (!graph->nodeOf(a, u) || !graph->nodeOf(b, v)) return;
+        ensureCapacity(graph->nodeCount());
+        shared_lock<shared_mutex> guard(resultsLock);
+        update(u, {v, 0});  // connected now, so no longer a suggestion
+        update(v, {u, 0});
+
+        vector<uint32_t> friendsOfU, friendsOfV, others;
+        graph->connectionsOf(u, friendsOfU);
+        graph->connectionsOf(v, friendsOfV);
+        auto introduce = [&](uint32_t self, const vector<uint32_t>& own, const vector<uint32_t>& through) {
+            if (through.size() > kHubDegree) return;
+            for (uint32_t w : through) {
+                if (w == self || binary_search(own.begin(), own.end(), w)) continue;
+                graph->connectionsOf(w, others);
+                uint32_t mutual = (uint32_t)intersectionSize(own.data(), own.size(), others.data(), others.size());
+                update(self, {w, mutual});
+                update(w, {self, mutual});
+            }
+        };
+        introduce(u, friendsOfU, friendsOfV);
+        introduce(v, friendsOfV, friendsOfU);
+    }
+
+    vector<Suggestion> getSuggestions(int userId) {
+        vector<Suggestion> result;
+        uint32_t node;
+        if (!graph->nodeOf(userId, node)) return result;
+        vector<Candidate> list;
+        {
+            shared_lock<shared_mutex> guard(resultsLock);
+            if (node >= results.size()) return result;
+            lock_guard<mutex> stripe(stripes[node % kStripes]);
+            list = results[node];
+        }
+        for (const Candidate& c : list) result.push_back({graph->userIdOf(c.node), c.mutual});
+        return result;
+    }
+};
+
+// CONNECTION DEGREE
+
+// Bitset over node ids that remembers which words it set, so clearing it between
+// queries costs what the query touched rather than the size of the graph
+class NodeMarks {
+private:
+    vector<uint64_t> words;
+    vector<uint32_t> dirty;
+
+public:
+    void reset(uint32_t nodes) {
+        for (uint32_t w : dirty) words[w] = 0;
+        dirty.clear();
+        if (words.size() < nodes / 64 + 1) words.resize(nodes / 64 + 1, 0);
+    }
+
+    void set(uint32_t node) {
+        uint64_t& word = words[node >> 6];
+        if (!word) dirty.push_back(node >> 6);
+        word |= 1ull << (node & 63);
+    }
+
+    bool test(uint32_t node) const { return node >> 6 < words.size() && (words[node >> 6] >> (node & 63) & 1); }
+};
+
+// 1st/2nd/3rd degree labels between users. Every query works under a budget of edge
+// scans so a pair of hubs can't stall a request; past it, or past the 3rd degree, the
+// answer is kOutOfNetwork.
+class ConnectionDegreeService {
+private:
+    static constexpr size_t kMaxEdgeScans = 1000000;
+
+    SocialGraph* graph;
+
+    struct Scratch {
+        NodeMarks first, second;
+        vector<uint32_t> sideA, sideB, row;
+    };
+
+    static Scratch& scratch() {
+        static thread_local Scratch instance;
+        return instance;
+    }
+
+    // Edges scanned to expand every node of `frontier` by one hop
+    static size_t expansionCost(const CsrAdjacency& connections, const vector<uint32_t>& frontier) {
+        size_t cost = 0;
+        for (uint32_t n : frontier) cost += connections.degree(n);
+        return cost;
+    }
+
+    // Bidirectional search: one hop from each side, then one more hop from whichever
+    // side is cheaper to expand, checked against the other side's marks
+    int pairDegree(const CsrAdjacency& connections, uint32_t nodes, uint32_t u, uint32_t v) {
+        Scratch& s = scratch();
+        connections.neighbors(u, s.sideA);
+        connections.neighbors(v, s.sideB);
+        if (binary_search(s.sideA.begin(), s.sideA.end(), v)) return 1;
+        if (intersectionSize(s.sideA.data(), s.sideA.size(), s.sideB.data(), s.sideB.size()) > 0) return 2;
+
+        size_t costA = expansionCost(connections, s.sideA), costB = expansionCost(connections, s.sideB);
+        if (costB < costA) s.sideA.swap(s.sideB);
+        if (min(costA, costB) > kMaxEdgeScans) return kOutOfNetwork;
+        s.first.reset(nodes);
+        for (uint32_t n : s.sideB) s.first.set(n);
+        for (uint32_t x : s.sideA) {
+            connections.neighbors(x, s.row);
+            for (uint32_t z : s.row) {
+                if (s.first.test(z)) return 3;
+            }
+        }
+        return kOutOfNetwork;
+    }
+
+public:
+    static constexpr int kOutOfNetwork = -1;
+
+    ConnectionDegreeService(SocialGraph* socialGraph) : graph(socialGraph) {}
+
+    // 0 for the same user, 1 to 3 for connections of that degree, else kOutOfNetwork
+    int degree(int a, int b) {
+        if (a == b) return 0;
+        uint32_t u, v;
+        if (!graph->nodeOf(a, u) || !graph->nodeOf(b, v)) return kOutOfNetwork;
+        int result = kOutOfNetwork;
+        graph->readConnections([&](const CsrAdjacency& connections, uint32_t nodes) {
+            result = pairDegree(connections, nodes, u, v);
+        });
+        return result;
+    }
+
+    // Degrees from one viewer to every user on a results page. The viewer's 1st and 2nd
+    // degree sets are marked once and shared, so each target costs only its own
+    // connection list, charged to the same budget as the marking; targets that no longer
+    // fit are kOutOfNetwork. Viewers whose 2nd degree set is over budget fall back to
+    // per-pair searches.
+    vector<int> degrees(int viewer, const vector<int>& targets) {
+        vector<int> result(targets.size(), kOutOfNetwork);
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (targets[i] == viewer) result[i] = 0;
+        }
+        uint32_t u;
+        if (!graph->nodeOf(viewer, u)) return result;
+        vector<uint32_t> targetNodes(targets.size(), UINT32_MAX);
+        for (size_t i = 0; i < targets.size(); i++) graph->nodeOf(targets[i], targetNodes[i]);
+
+        graph->readConnections([&](const CsrAdjacency& connections, uint32_t nodes) {
+            Scratch& s = scratch();
+            vector<uint32_t> viewerFriends, targetFriends;
+            connections.neighbors(u, viewerFriends);
+            size_t scans = expansionCost(connections, viewerFriends);
+            bool shared = scans <= kMaxEdgeScans;
+            if (shared) {
+                s.first.reset(nodes);
+                s.second.reset(nodes);
+                for (uint32_t f : viewerFriends) s.first.set(f);
+                for (uint32_t f : viewerFriends) {
+                    connections.neighbors(f, s.row);
+                    for (uint32_t w : s.row) {
+                        if (w != u && !s.first.test(w)) s.second.set(w);
+                    }
+                }
+            }
+            for (size_t i = 0; i < targets.size(); i++) {
+                uint32_t v = targetNodes[i];
+                if (targets[i] == viewer || v == UINT32_MAX) {
+                    continue;
+                } else if (!shared) {
+                    result[i] = pairDegree(connections, nodes, u, v);
+                } else if (s.first.test(v)) {
+                    result[i] = 1;
+                } else if (s.second.test(v)) {
+                    result[i] = 2;
+                } else {
+                    size_t cost = connections.degree(v);
+                    if (scans + cost > kMaxEdgeScans) continue;
+                    scans += cost;
+                    connections.neighbors(v, targetFriends);
+                    for (uint32_t w : targetFriends) {
+                        if (s.second.test(w)) {
+                            result[i] = 3;
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+        return result;
+    }
+};
+
+// FEED
+
+struct FeedEntry {
+    time_t timestamp;
+    int postId;
+    int authorId;
+};
+
+// Feed pages run newest first; a cursor asks for the entries strictly older than it
+struct FeedCursor {
+    time_t timestamp = numeric_limits<time_t>::max();
+    int postId = INT_MAX;
+};
+
+static bool olderThan(const FeedEntry& entry, const FeedCursor& cursor) {
+    return entry.timestamp != cursor.timestamp ? entry.timestamp < cursor.timestamp : entry.postId < cursor.postId;
+}
+
+static bool newerFirst(const FeedEntry& a, const FeedEntry& b) {
+    return a.timestamp != b.timestamp ? a.timestamp > b.timestamp : a.postId > b.postId;
+}
+
+// Fixed-capacity ring of feed entries kept oldest to newest. Once full, the oldest
+// entry is dropped for every new one, so memory per user is bounded.
+class Timeline {
+private:
+    vector<FeedEntry> entries;
+    size_t start = 0;
+    size_t count = 0;
+    mutable mutex lock;
+
+    FeedEntry& at(size_t i) { return entries[(start + i) % entries.size()]; }
+    const FeedEntry& at(size_t i) const { return entries[(start + i) % entries.size()]; }
+
+public:
+    Timeline(size_t capacity) : entries(capacity) {}
+
+    void push(const FeedEntry& entry) {
+        lock_guard<mutex> guard(lock);
+        if (count == entries.size()) {
+            if (!newerFirst(entry, at(0))) return;  // older than everything we keep
+            start = (start + 1) % entries.size();
+            count--;
+        }
+        // Posts fanned out concurrently can arrive slightly out of order; slot them in from the back
+        size_t i = count++;
+        while (i > 0 && newerFirst(at(i - 1), entry)) {
+            at(i) = at(i - 1);
+            i--;
+        }
+        at(i) = entry;
+    }
+
+    // Drops every entry by `authorId`, keeping the rest in order
+    void removeAuthor(int authorId) {
+        lock_guard<mutex> guard(lock);
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (at(i).authorId != authorId) at(kept++) = at(i);
+        }
+        count = kept;
+    }
+
+    // Appends up to `limit` entries older than `before`, newest first
+    void collect(const FeedCursor& before, size_t limit, vector<FeedEntry>& out) const {
+        lock_guard<mutex> guard(lock);
+        size_t lo = 0, hi = count;  // first index not older than the cursor
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (olderThan(at(mid), before)) lo = mid + 1;
+            else hi = mid;
+        }
+        for (size_t i = lo; i > 0 && limit > 0; i--, limit--) out.push_back(at(i - 1));
+    }
+};
+
+// Fan-out on write: a new post is pushed into the timeline of every follower, so reading
+// a feed page is one ring lookup. Accounts with more than kPullThreshold followers are
+// not fanned out; their followers pull from the author's own outbox at read time and
+// merge, which bounds the write cost of a celebrity post.
+class FeedService {
+private:
+    static constexpr size_t kTimelineCapacity = 800;
+    static constexpr size_t kPullThreshold = 5000;
+
+    SocialGraph* graph;
+    shared_mutex lock;  // guards the maps below; timelines have their own locks
+    unordered_map<int, unique_ptr<Timeline>> timelines;
+    unordered_map<int, unique_ptr<Timeline>> outboxes;
+    unordered_map<int, vector<int>> pullSources;  // pull accounts each user follows
+    unordered_set<int> pullAccounts;
+    unordered_map<int, Post*> posts;
+
+    Timeline* timelineOf(unordered_map<int, unique_ptr<Timeline>>& timelinesById, int userId) {
+        auto it = timelinesById.find(userId);
+        if (it == timelinesById.end()) it = timelinesById.emplace(userId, make_unique<Timeline>(kTimelineCapacity)).first;
+        return it->second.get();
+    }
+
+    void dropPullSource(int userId, int authorId) {
+        auto sources = pullSources.find(userId);
+        if (sources == pullSources.end()) return;
+        vector<int>& ids = sources->second;
+        ids.erase(remove(ids.begin(), ids.end(), authorId), ids.end());
+        if (ids.empty()) pullSources.erase(sources);
+    }
+
+    void backfill(int followerId, int followeeId) {
+        vector<FeedEntry> recent;
+        timelineOf(outboxes, followeeId)->collect(FeedCursor(), kTimelineCapacity, recent);
+        Timeline* timeline = timelineOf(timelines, followerId);
+        for (const FeedEntry& entry : recent) timeline->push(entry);
+    }
+
+public:
+    FeedService(SocialGraph* socialGraph) : graph(socialGraph) {}
+
+    // Called once the follow is recorded in the graph
+    void follow(int followerId, int followeeId) {
+        unique_lock<shared_mutex> guard(lock);
+        if (pullAccounts.count(followeeId)) {
+            pullSources[followerId].push_back(followeeId);
+        } else if (graph->followerCount(followeeId) > kPullThreshold) {
+            // Promoted once; from now on every follower pulls this account
+            pullAccounts.insert(followeeId);
+            for (int id : graph->getFollowers(followeeId)) pullSources[id].push_back(followeeId);
+        } else {
+            // Backfill so the new follower sees the followee's recent posts right away
+            backfill(followerId, followeeId);
+        }
+    }
+
+    // Called once the unfollow is recorded in the graph. A pull account that falls to
+    // half the threshold goes back to fan-out, so its remaining followers stop pulling
+    // it and get its recent posts pushed into their timelines instead.
+    void unfollow(int followerId, int followeeId) {
+        unique_lock<shared_mutex> guard(lock);
+        dropPullSource(followerId, followeeId);
+        auto own = timelines.find(followerId);
+        if (own != timelines.end()) own->second->removeAuthor(followeeId);
+        if (pullAccounts.count(followeeId) && graph->followerCount(followeeId) <= kPullThreshold / 2) {
+            pullAccounts.erase(followeeId);
+            for (int id : graph->getFollowers(followeeId)) {
+                dropPullSource(id, followeeId);
+                timelineOf(timelines, id)->removeAuthor(followeeId);  // pre-promotion copies
+                backfill(id, followeeId);
+            }
+        }
+    }
+
+    void publish(Post* post) {
+        FeedEntry entry{post->getTimestamp(), post->getPostId(), post->getUserId()};
+        vector<int> targets;
+        {
+            unique_lock<shared_mutex> guard(lock);
+            posts[post->getPostId()] = post;
+            timelineOf(outboxes, post->getUserId());
+            timelineOf(timelines, post->getUserId());
+            if (!pullAccounts.count(post->getUserId())) {
+                targets = graph->getFollowers(post->getUserId());
+                for (int id : targets) timelineOf(timelines, id);
+            }
+        }
+        // All timelines exist now, so the fan-out only needs the map read lock
+        shared_lock<shared_mutex> guard(lock);
+        outboxes.at(post->getUserId())->push(entry);
+        timelines.at(post->getUserId())->push(entry);
+        for (int id : targets) timelines.at(id)->push(entry);
+    }
+
+    // One page of the user's feed, newest first. Reads the user's own timeline plus the
+    // outbox of each pull account they follow, taking at most `pageSize` from each.
+    // Posts fanned out before their author was promoted to pull are in both, so the
+    // merge drops the second copy.
+    vector<FeedEntry> getFeed(int userId, size_t pageSize, FeedCursor before = FeedCursor()) {
+        vector<FeedEntry> page;
+        shared_lock<shared_mutex> guard(lock);
+        auto own = timelines.find(userId);
+        if (own != timelines.end()) own->second->collect(before, pageSize, page);
+        auto sources = pullSources.find(userId);
+        if (sources != pullSources.end()) {
+            for (int authorId : sources->second) {
+                auto outbox = outboxes.find(authorId);
+                if (outbox != outboxes.end()) outbox->second->collect(before, pageSize, page);
+            }
+            sort(page.begin(), page.end(), newerFirst);
+            page.erase(unique(page.begin(), page.end(),
+                              [](const FeedEntry& a, const FeedEntry& b) { return a.postId == b.postId; }),
+                       page.end());
+            if (page.size() > pageSize) page.resize(pageSize);
+        }
+        return page;
+    }
+
+    Post* getPost(int postId) {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = posts.find(postId);
+        return it == posts.end() ? nullptr : it->second;
+    }
+};
+
 // COMPANY
 
 class Company {
@@ -233,10 +1515,18 @@ private:
     string name;
     string description;
     time_t doc;
-    int total_strength;
+    int total_strength = 0;
     vector<JobPosting*> postings;
 
 public:
+    Company(int id, string companyName, string desc) : company_id(id), name(companyName), description(desc) {
+        doc = time(nullptr);
+    }
+
+    int getCompanyId() const { return company_id; }
+    const string& getName() const { return name; }
+    const string& getDescription() const { return description; }
+
     void addJobPosting(JobPosting* posting) {
         postings.push_back(posting);
     }
@@ -251,7 +1541,6 @@ private:
     string first_name;
     string last_name;
     int userId;
-    vector<Message*> inbox;
     vector<Notification*> notifications;
 
 public:
@@ -262,10 +1551,12 @@ public:
 
     int getUserId() { return userId; }
     Profile* getProfile() { return profile; }
+    void setName(string first, string last) { first_name = first; last_name = last; }
+    const string& getFirstName() const { return first_name; }
+    const string& getLastName() const { return last_name; }
 
     void sendMessage(User* receiver, string text) {
-        Message* msg = new Message(userId, receiver->getUserId(), text);
-        receiver->inbox.push_back(msg);
+        MessageService::send(userId, receiver->getUserId(), text);
         NotificationService::sendNotification(receiver->getUserId(), "New message received.");
     }
 
@@ -294,8 +1585,452 @@ public:
     void addUser(int uid) { users.insert(uid); }
 };
 
+// SEARCH
+
+enum class SearchDocType {
+    USER,
+    COMPANY,
+    JOB
+};
+
+struct SearchQuery {
+    string text;
+    SearchDocType type;
+    string company;   // filters; empty means any
+    string skill;
+    string location;
+    size_t limit = 10;
+};
+
+struct SearchHit {
+    SearchDocType type;
+    int id;
+    double score;
+};
+
+// Inverted index over people, companies and job postings, ranked with BM25. Documents
+// go into an active segment that is sealed every kSegmentDocs documents, and a query
+// scores the segments in parallel. Re-indexing a document tombstones its old copy and
+// adds a new one; corpus statistics are kept exact across updates.
+class SearchIndex {
+private:
+    static constexpr size_t kSegmentDocs = 4096;
+    static constexpr double kK1 = 1.2;
+    static constexpr double kB = 0.75;
+
+    struct Document {
+        SearchDocType type;
+        int id;
+        uint32_t length;
+        bool deleted;
+        string company;           // normalized filter values
+        string location;
+        vector<string> skills;
+        vector<string> terms;     // distinct terms, to retract them from the statistics
+    };
+
+    struct Posting {
+        uint32_t doc;  // index within the segment
+        uint32_t frequency;
+    };
+
+    struct Segment {
+        vector<Document> docs;
+        unordered_map<string, vector<Posting>> postings;
+        size_t deleted = 0;
+    };
+
+    mutable shared_mutex lock;
+    vector<unique_ptr<Segment>> segments;
+    unordered_map<uint64_t, pair<uint32_t, uint32_t>> locations;  // document key -> segment, doc
+    unordered_map<string, uint32_t> documentFrequency;
+    size_t liveDocs = 0;
+    size_t totalLength = 0;
+    mutable WorkStealingPool pool;  // shared by every query, see WorkStealingPool::run
+
+    static uint64_t keyOf(SearchDocType type, int id) { return (uint64_t)type << 32 | (uint32_t)id; }
+
+    void remove(uint64_t key) {
+        auto it = locations.find(key);
+        if (it == locations.end()) return;
+        Document& doc = segments[it->second.first]->docs[it->second.second];
+        doc.deleted = true;
+        for (const string& term : doc.terms) {
+            if (--documentFrequency[term] == 0) documentFrequency.erase(term);
+        }
+        liveDocs--;
+        totalLength -= doc.length;
+        Segment& segment = *segments[it->second.first];
+        uint32_t segmentIndex = it->second.first;
+        locations.erase(it);
+        if (++segment.deleted * 2 > segment.docs.size()) purge(segmentIndex);
+    }
+
+    // Drops tombstoned documents from a segment once they are the majority
+    void purge(uint32_t segmentIndex) {
+        Segment& segment = *segments[segmentIndex];
+        vector<uint32_t> remap(segment.docs.size(), UINT32_MAX);
+        vector<Document> docs;
+        for (uint32_t d = 0; d < segment.docs.size(); d++) {
+            if (segment.docs[d].deleted) continue;
+            remap[d] = (uint32_t)docs.size();
+            locations[keyOf(segment.docs[d].type, segment.docs[d].id)] = {segmentIndex, remap[d]};
+            docs.push_back(move(segment.docs[d]));
+        }
+        for (auto it = segment.postings.begin(); it != segment.postings.end();) {
+            vector<Posting> kept;
+            for (const Posting& posting : it->second) {
+                if (remap[posting.doc] != UINT32_MAX) kept.push_back({remap[posting.doc], posting.frequency});
+            }
+            if (kept.empty()) {
+                it = segment.postings.erase(it);
+            } else {
+                it->second.swap(kept);
+                ++it;
+            }
+        }
+        segment.docs.swap(docs);
+        segment.deleted = 0;
+    }
+
+    void add(SearchDocType type, int id, const string& text, const string& company, const string& location,
+             const vector<string>& skills) {
+        uint64_t key = keyOf(type, id);
+        remove(key);
+        if (segments.empty() || segments.back()->docs.size() >= kSegmentDocs) segments.push_back(make_unique<Segment>());
+        Segment& segment = *segments.back();
+
+        unordered_map<string, uint32_t> counts;
+        uint32_t length = 0;
+        for (string& token : tokenize(text)) {
+            counts[token]++;
+            length++;
+        }
+        Document doc{type, id, length, false, normalize(company), normalize(location), {}, {}};
+        for (const string& skill : skills) doc.skills.push_back(normalize(skill));
+        uint32_t index = (uint32_t)segment.docs.size();
+        for (auto& entry : counts) {
+            segment.postings[entry.first].push_back({index, entry.second});
+            documentFrequency[entry.first]++;
+            doc.terms.push_back(entry.first);
+        }
+        segment.docs.push_back(move(doc));
+        locations[key] = {(uint32_t)segments.size() - 1, index};
+        liveDocs++;
+        totalLength += length;
+    }
+
+    static bool passes(const Document& doc, const SearchQuery& query, const string& company, const string& skill,
+                       const string& location) {
+        if (doc.deleted || doc.type != query.type) return false;
+        if (!company.empty() && doc.company != company) return false;
+        if (!location.empty() && doc.location != location) return false;
+        if (!skill.empty() && find(doc.skills.begin(), doc.skills.end(), skill) == doc.skills.end()) return false;
+        return true;
+    }
+
+public:
+    SearchIndex(int threadCount = (int)max(1u, thread::hardware_concurrency())) : pool(threadCount) {}
+
+    // Lowercased runs of letters and digits. A '+' or '#' after a run and a '.' before one
+    // stay in the token, so "C++", "C#" and ".NET" don't all collapse into "c" and "net".
+    static vector<string> tokenize(const string& text) {
+        vector<string> tokens;
+        string current;
+        for (size_t i = 0; i < text.size(); i++) {
+            unsigned char c = (unsigned char)text[i];
+            if (isalnum(c)) {
+                current += (char)tolower(c);
+            } else if ((c == '+' || c == '#') && !current.empty()) {
+                current += (char)c;
+            } else if (c == '.' && i + 1 < text.size() && isalnum((unsigned char)text[i + 1])) {
+                current += (char)c;
+            } else if (!current.empty()) {
+                tokens.push_back(move(current));
+                current.clear();
+            }
+        }
+        if (!current.empty()) tokens.push_back(move(current));
+        return tokens;
+    }
+
+    static string normalize(const string& value) {
+        string result;
+        for (const string& token : tokenize(value)) result += (result.empty() ? "" : " ") + token;
+        return result;
+    }
+
+    // Adds the user or replaces what was indexed for them before
+    void indexUser(User* user) {
+        Profile* profile = user->getProfile();
+        string text = user->getFirstName() + " " + user->getLastName();
+        string company;
+        vector<string> skills;
+        for (Skill* skill : profile->getSkills()) {
+            text += " " + skill->getName();
+            skills.push_back(skill->getName());
+        }
+        for (Experience* exp : profile->getExperiences()) {
+            text += " " + exp->getName() + " " + exp->getDesignation() + " " + exp->getCompanyName();
+            company = exp->getCompanyName();  // addExperience appends, so the last one is current
+        }
+        unique_lock<shared_mutex> guard(lock);
+        add(SearchDocType::USER, user->getUserId(), text, company, profile->getLocation(), skills);
+    }
+
+    void indexCompany(Company* company) {
+        unique_lock<shared_mutex> guard(lock);
+        add(SearchDocType::COMPANY, company->getCompanyId(), company->getName() + " " + company->getDescription(),
+            company->getName(), "", {});
+    }
+
+    void indexJob(JobPosting* job, Company* company, const vector<string>& skills = {}) {
+        string text = job->getTitle() + " " + job->getDescription() + " " + company->getName();
+        for (const string& skill : skills) text += " " + skill;
+        unique_lock<shared_mutex> guard(lock);
+        add(SearchDocType::JOB, job->getPostId(), text, company->getName(), job->getLocation(), skills);
+    }
+
+    void removeUser(int userId) {
+        unique_lock<shared_mutex> guard(lock);
+        remove(keyOf(SearchDocType::USER, userId));
+    }
+
+    vector<SearchHit> search(const SearchQuery& query) const {
+        vector<string> terms = tokenize(query.text);
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        string company = normalize(query.company), skill = normalize(query.skill), location = normalize(query.location);
+
+        shared_lock<shared_mutex> guard(lock);
+        if (liveDocs == 0) return {};
+        double averageLength = (double)totalLength / liveDocs;
+        vector<double> idf;
+        for (const string& term : terms) {
+            auto df = documentFrequency.find(term);
+            double n = df == documentFrequency.end() ? 0 : df->second;
+            idf.push_back(log(1 + (liveDocs - n + 0.5) / (n + 0.5)));
+        }
+
+        vector<vector<SearchHit>> partial(pool.size());
+        pool.run(segments.size(), [&](size_t s, int worker) {
+            const Segment& segment = *segments[s];
+            vector<double> scores(segment.docs.size(), 0);
+            vector<uint32_t> touched;
+            for (size_t t = 0; t < terms.size(); t++) {
+                auto postings = segment.postings.find(terms[t]);
+                if (postings == segment.postings.end()) continue;
+                for (const Posting& posting : postings->second) {
+                    const Document& doc = segment.docs[posting.doc];
+                    if (!passes(doc, query, company, skill, location)) continue;
+                    double tf = posting.frequency;
+                    if (scores[posting.doc] == 0) touched.push_back(posting.doc);
+                    scores[posting.doc] += idf[t] * tf * (kK1 + 1) / (tf + kK1 * (1 - kB + kB * doc.length / averageLength));
+                }
+            }
+            vector<SearchHit>& hits = partial[worker];
+            for (uint32_t d : touched) hits.push_back({segment.docs[d].type, segment.docs[d].id, scores[d]});
+        });
+
+        vector<SearchHit> hits;
+        for (auto& part : partial) hits.insert(hits.end(), part.begin(), part.end());
+        size_t keep = min(query.limit, hits.size());
+        partial_sort(hits.begin(), hits.begin() + keep, hits.end(), [](const SearchHit& a, const SearchHit& b) {
+            return a.score != b.score ? a.score > b.score : a.id < b.id;
+        });
+        hits.resize(keep);
+        return hits;
+    }
+};
+
 // REPOSITORIES
 
+// Id -> object map for the repositories. Ids are hashed onto kShards shards; writers
+// lock their shard only, readers take no lock at all. Each shard is an open-addressing
+// table of atomic slots: a writer fills the value before publishing the key, and a
+// removal clears the value but keeps the key as a tombstone, so a reader probing
+// concurrently sees either the old or the new state of a slot, never a torn one.
+// Inserts reuse tombstones; a reused key carries a bumped reuse count, and a reader
+// re-checks the key after loading the value, so it never returns another id's value.
+// A full table is copied into a larger one and swapped in. Readers announce themselves
+// on one of two per-shard counters, and the writer frees the old table only after both
+// counters have drained once (a grace period), as readers may still be probing it.
+template <typename T>
+class ConcurrentIdMap {
+private:
+    static constexpr int kShards = 64;
+    static constexpr int64_t kEmpty = INT64_MIN;
+
+    struct Table {
+        size_t mask;
+        unique_ptr<atomic<int64_t>[]> keys;
+        unique_ptr<atomic<T*>[]> values;
+        size_t used = 0;  // slots with a key, tombstones included
+        size_t live = 0;
+
+        Table(size_t capacity) : mask(capacity - 1), keys(new atomic<int64_t>[capacity]), values(new atomic<T*>[capacity]) {
+            for (size_t i = 0; i < capacity; i++) {
+                keys[i].store(kEmpty, memory_order_relaxed);
+                values[i].store(nullptr, memory_order_relaxed);
+            }
+        }
+    };
+
+    struct alignas(64) Shard {
+        mutex writeLock;
+        atomic<Table*> table{nullptr};
+        unique_ptr<Table> owned;  // the table published in `table`
+        atomic<unsigned> epoch{0};
+        atomic<int> readers[2]{};
+    };
+
+    // Keeps the table a reader loaded alive until the reader is done with it
+    class ReadGuard {
+    private:
+        atomic<int>& readers;
+
+    public:
+        ReadGuard(Shard& shard) : readers(shard.readers[shard.epoch.load() & 1]) { readers.fetch_add(1); }
+        ~ReadGuard() { readers.fetch_sub(1, memory_order_release); }
+    };
+
+    Shard shards[kShards];
+
+    static uint64_t hashOf(int id) {
+        uint64_t h = (uint64_t)(uint32_t)id * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+
+    // Slot keys hold the id in the low 32 bits and the slot's reuse count above them
+    static int64_t keyOf(int id, uint64_t reuse) {
+        return (int64_t)(((reuse & 0x7FFFFFFF) << 32) | (uint32_t)id);
+    }
+
+    static bool holds(int64_t key, int id) { return key != kEmpty && (uint32_t)key == (uint32_t)id; }
+
+    Shard& shardOf(uint64_t hash) { return shards[hash % kShards]; }
+
+    // Caller holds the shard's write lock
+    void insert(Shard& shard, uint64_t hash, int id, T* value) {
+        Table* table = shard.table.load(memory_order_relaxed);
+        if (!table || (table->used + 1) * 2 > table->mask + 1) table = grow(shard);
+        size_t tombstone = SIZE_MAX;
+        size_t i = (hash / kShards) & table->mask;
+        for (;; i = (i + 1) & table->mask) {
+            int64_t key = table->keys[i].load(memory_order_relaxed);
+            if (holds(key, id)) {
+                if (!table->values[i].load(memory_order_relaxed)) table->live++;
+                table->values[i].store(value, memory_order_release);
+                return;
+            }
+            if (key == kEmpty) break;
+            if (tombstone == SIZE_MAX && !table->values[i].load(memory_order_relaxed)) tombstone = i;
+        }
+        table->live++;
+        if (tombstone != SIZE_MAX) {
+            // Key first: a reader still matching the old id sees it change and backs off
+            uint64_t reuse = (uint64_t)table->keys[tombstone].load(memory_order_relaxed) >> 32;
+            table->keys[tombstone].store(keyOf(id, reuse + 1), memory_order_relaxed);
+            table->values[tombstone].store(value, memory_order_release);
+            return;
+        }
+        table->values[i].store(value, memory_order_relaxed);
+        table->keys[i].store(keyOf(id, 0), memory_order_release);
+        table->used++;
+    }
+
+    Table* grow(Shard& shard) {
+        Table* old = shard.table.load(memory_order_relaxed);
+        size_t capacity = 16;
+        while (old && capacity < (old->live + 1) * 4) capacity *= 2;
+        auto table = make_unique<Table>(capacity);
+        if (old) {
+            for (size_t i = 0; i <= old->mask; i++) {
+                T* value = old->values[i].load(memory_order_relaxed);
+                if (!value) continue;
+                int id = (int)(uint32_t)old->keys[i].load(memory_order_relaxed);
+                size_t j = (hashOf(id) / kShards) & table->mask;
+                while (table->keys[j].load(memory_order_relaxed) != kEmpty) j = (j + 1) & table->mask;
+                table->values[j].store(value, memory_order_relaxed);
+                table->keys[j].store(keyOf(id, 0), memory_order_relaxed);
+                table->used++;
+                table->live++;
+            }
+        }
+        shard.table.store(table.get());
+        shard.owned.swap(table);
+        if (table) awaitReaders(shard);
+        return shard.owned.get();
+    }
+
+    // Flips the shard's epoch twice, waiting each time for the readers counted under
+    // the previous epoch; any reader that loaded the old table has then finished.
+    void awaitReaders(Shard& shard) {
+        for (int flip = 0; flip < 2; flip++) {
+            unsigned parity = shard.epoch.fetch_add(1) & 1;
+            while (shard.readers[parity].load() != 0) this_thread::yield();
+        }
+    }
+
+public:
+    T* get(int id) {
+        uint64_t hash = hashOf(id);
+        Shard& shard = shardOf(hash);
+        ReadGuard guard(shard);
+        Table* table = shard.table.load();
+        if (!table) return nullptr;
+        for (size_t i = (hash / kShards) & table->mask;; i = (i + 1) & table->mask) {
+            int64_t key = table->keys[i].load(memory_order_acquire);
+            if (key == kEmpty) return nullptr;
+            if (!holds(key, id)) continue;
+            T* value = table->values[i].load(memory_order_acquire);
+            // A changed key means the slot was a tombstone for id when it was reused
+            return table->keys[i].load(memory_order_relaxed) == key ? value : nullptr;
+        }
+    }
+
+    void put(int id, T* value) {
+        uint64_t hash = hashOf(id);
+        Shard& shard = shardOf(hash);
+        lock_guard<mutex> guard(shard.writeLock);
+        insert(shard, hash, id, value);
+    }
+
+    void erase(int id) {
+        uint64_t hash = hashOf(id);
+        Shard& shard = shardOf(hash);
+        lock_guard<mutex> guard(shard.writeLock);
+        Table* table = shard.table.load(memory_order_relaxed);
+        if (!table) return;
+        for (size_t i = (hash / kShards) & table->mask;; i = (i + 1) & table->mask) {
+            int64_t key = table->keys[i].load(memory_order_relaxed);
+            if (key == kEmpty) return;
+            if (holds(key, id)) {
+                if (table->values[i].exchange(nullptr, memory_order_release)) table->live--;
+                return;
+            }
+        }
+    }
+
+    vector<T*> getMany(const vector<int>& ids) {
+        vector<T*> result;
+        result.reserve(ids.size());
+        for (int id : ids) result.push_back(get(id));
+        return result;
+    }
+
+    // Writes grouped by shard, so each shard lock is taken once per batch
+    void putMany(const vector<pair<int, T*>>& entries) {
+        vector<vector<size_t>> byShard(kShards);
+        for (size_t i = 0; i < entries.size(); i++) byShard[hashOf(entries[i].first) % kShards].push_back(i);
+        for (int s = 0; s < kShards; s++) {
+            if (byShard[s].empty()) continue;
+            lock_guard<mutex> guard(shards[s].writeLock);
+            for (size_t i : byShard[s]) insert(shards[s], hashOf(entries[i].first), entries[i].first, entries[i].second);
+        }
+    }
+};
+
 class IUserRepository {
 public:
     virtual void addUser(User* user) = 0;
@@ -304,11 +2039,11 @@ public:
 
 class UserRepository : public IUserRepository {
 private:
-    unordered_map<int, User*> users;
+    ConcurrentIdMap<User> users;
 
 public:
     void addUser(User* user) override {
-        users[user->getUserId()] = user;
+        users.put(user->getUserId(), user);
     }
 
     void removeUser(User* user) override {
@@ -316,7 +2051,17 @@ public:
     }
 
     User* getUser(int uid) {
-        return users.count(uid) ? users[uid] : nullptr;
+        return users.get(uid);
+    }
+
+    vector<User*> getUsers(const vector<int>& uids) {
+        return users.getMany(uids);
+    }
+
+    void addUsers(const vector<User*>& batch) {
+        vector<pair<int, User*>> entries;
+        for (User* user : batch) entries.push_back({user->getUserId(), user});
+        users.putMany(entries);
     }
 };
 
@@ -328,16 +2073,30 @@ public:
 
 class GroupRepository : public IGroupRepository {
 private:
-    unordered_map<int, Group*> groups;
+    ConcurrentIdMap<Group> groups;
 
 public:
     void addGroup(Group* grp) override {
-        groups[grp->getGroupId()] = grp;
+        groups.put(grp->getGroupId(), grp);
     }
 
     void removeGroup(Group* grp) override {
         groups.erase(grp->getGroupId());
     }
+
+    Group* getGroup(int groupId) {
+        return groups.get(groupId);
+    }
+
+    vector<Group*> getGroups(const vector<int>& groupIds) {
+        return groups.getMany(groupIds);
+    }
+
+    void addGroups(const vector<Group*>& batch) {
+        vector<pair<int, Group*>> entries;
+        for (Group* grp : batch) entries.push_back({grp->getGroupId(), grp});
+        groups.putMany(entries);
+    }
 };
 
 // SERVICES
@@ -366,10 +2125,37 @@ public:
     }
 };
 
+class ConnectionService {
+public:
+    static void acceptRequest(SocialGraph* graph, PeopleYouMayKnow* pymk, ConnectionRequest* request) {
+        request->accept();
+        if (graph->connect(request->getFromUserId(), request->getToUserId())) {
+            pymk->onConnectionAccepted(request->getFromUserId(), request->getToUserId());
+        }
+    }
+};
+
 class FollowService {
 public:
-    static void followUser(User* follower, User* followee) {
-        follower->getProfile()->addRecommendation(new Recommendation());
+    static void followUser(SocialGraph* graph, FeedService* feed, User* follower, User* followee) {
+        if (!graph->follow(follower->getUserId(), followee->getUserId())) return;
+        follower->getProfile()->addFollowing(followee);
+        feed->follow(follower->getUserId(), followee->getUserId());
+    }
+
+    static void unfollowUser(SocialGraph* graph, FeedService* feed, User* follower, User* followee) {
+        if (!graph->unfollow(follower->getUserId(), followee->getUserId())) return;
+        follower->getProfile()->removeFollowing(followee);
+        feed->unfollow(follower->getUserId(), followee->getUserId());
+    }
+};
+
+class PostService {
+public:
+    static Post* createPost(FeedService* feed, int postId, User* author, string title, string body) {
+        Post* post = new Post(postId, author->getUserId(), title, body);
+        feed->publish(post);
+        return post;
     }
 };
 
@@ -380,15 +2166,34 @@ int main() {
     User* alice = new User(1);
     User* bob = new User(2);
     userRepo->addUser(alice);
-    userRepo.addUser(bob);
+    userRepo->addUser(bob);
 
     NotificationService::setStrategy(new InAppNotificationStrategy());
+    MessageService::setStore(new MessageStore());
 
     alice->sendMessage(bob, "Hi Bob!");
 
     Group* g = GroupService::createGroup(groupRepo, 101, "Software Engineers", alice);
 
-    Post* post = new Post();
+    SocialGraph* graph = new SocialGraph();
+    FeedService* feed = new FeedService(graph);
+    FollowService::followUser(graph, feed, alice, bob);
+    PeopleYouMayKnow* pymk = new PeopleYouMayKnow(graph);
+    ConnectionService::acceptRequest(graph, pymk, new ConnectionRequest(alice->getUserId(), bob->getUserId()));
+    Post* post = PostService::createPost(feed, 10, bob, "Hello", "First post!");
+    cout << "Alice's feed has " << feed->getFeed(alice->getUserId(), 20).size() << " post(s)" << endl;
+
+    // Skill filters keep "C++" and "C#" apart
+    SearchIndex* search = new SearchIndex(2);
+    alice->getProfile()->addSkill(new Skill("C++", 5, "Systems"));
+    bob->getProfile()->addSkill(new Skill("C#", 3, "Services"));
+    search->indexUser(alice);
+    search->indexUser(bob);
+    SearchQuery csharp{"c++ c#", SearchDocType::USER, "", "C#", ""};
+    vector<SearchHit> hits = search->search(csharp);
+    cout << "C# developers: " << hits.size() << (hits.size() == 1 && hits[0].id == bob->getUserId() ? " (Bob)" : " (wrong)")
+         << endl;
+
     post->addComment(CommentService::createComment(10, 1, "Great post!"));
     post->addReaction(ReactionService::createReaction(ReactionType::LIKE, 1, 10));
 
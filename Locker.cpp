@@ -3,10 +3,20 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <ctime>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <fcntl.h>
+#include <sys/random.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace std::chrono;
@@ -17,6 +27,86 @@ enum class LockerSize { SMALL, MEDIUM, LARGE };
 enum class PackageSize { SMALL, MEDIUM, LARGE };
 enum class LockerStatus { CLOSED, BOOKED, AVAILABLE };
 
+const int kLockerSizes = 3;
+
+// ----------- Pools -----------
+
+// Reference to a pooled object. The generation changes every time the slot is
+// released, so a handle kept past the object's lifetime resolves to nullptr
+// instead of to whatever reuses the slot.
+struct PoolHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isNull() const { return index == UINT32_MAX; }
+};
+
+// Slot storage for objects with an explicit lifetime. Slots come in chunks that are
+// never freed, and a released slot is handed out again with its object intact (the
+// caller reinitialises it), so members such as vectors keep their capacity. Once the
+// pool has grown to the working set, acquire and release do no heap allocation.
+template <typename T>
+class SlotPool {
+    static const uint32_t kChunkSize = 1024;
+    static const uint32_t kMaxChunks = 4096;
+
+    struct Slot {
+        T value;
+        atomic<uint32_t> generation{0};
+    };
+
+    mutex lock;
+    atomic<Slot*> chunks[kMaxChunks] = {};
+    uint32_t used = 0;  // slots handed out at least once
+    vector<uint32_t> freeSlots;
+
+    Slot* slotAt(PoolHandle handle) {
+        if (handle.index >= kChunkSize * kMaxChunks) return nullptr;
+        Slot* chunk = chunks[handle.index / kChunkSize].load(memory_order_acquire);
+        if (!chunk) return nullptr;
+        Slot* slot = &chunk[handle.index % kChunkSize];
+        return slot->generation.load(memory_order_acquire) == handle.generation ? slot : nullptr;
+    }
+public:
+    ~SlotPool() {
+        for (auto& chunk : chunks) delete[] chunk.load();
+    }
+
+    // A free object and its handle, or nullptr once the pool is exhausted
+    T* acquire(PoolHandle& handle) {
+        lock_guard<mutex> guard(lock);
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (used == kChunkSize * kMaxChunks) return nullptr;
+            if (used % kChunkSize == 0) {
+                chunks[used / kChunkSize].store(new Slot[kChunkSize], memory_order_release);
+                freeSlots.reserve(used + kChunkSize);  // so release never allocates
+            }
+            index = used++;
+        }
+        Slot& slot = chunks[index / kChunkSize].load(memory_order_relaxed)[index % kChunkSize];
+        handle = PoolHandle{index, slot.generation.load(memory_order_relaxed)};
+        return &slot.value;
+    }
+
+    T* get(PoolHandle handle) {
+        Slot* slot = slotAt(handle);
+        return slot ? &slot->value : nullptr;
+    }
+
+    // Stale handles are ignored, so releasing twice is harmless
+    void release(PoolHandle handle) {
+        lock_guard<mutex> guard(lock);
+        Slot* slot = slotAt(handle);
+        if (!slot) return;
+        slot->generation.fetch_add(1, memory_order_release);
+        freeSlots.push_back(handle.index);
+    }
+};
+
 // ----------- Notification -----------
 
 class Notification {
@@ -43,18 +133,33 @@ public:
 // ----------- Item & Order -----------
 
 class Item {
-    int item_id, quantity;
+    int item_id = 0, quantity = 0;
+    PoolHandle handle;
 public:
+    Item() {}
     Item(int item_id, int quantity) : item_id(item_id), quantity(quantity) {}
+
+    void init(PoolHandle h, int id, int qty) { handle = h; item_id = id; quantity = qty; }
     int getItemId() { return item_id; }
+    PoolHandle getHandle() { return handle; }
 };
 
 class Order {
-    int order_id;
+    int order_id = 0;
     vector<Item*> items;
+    PoolHandle handle;
 public:
-    Order(int order_id, vector<Item*> items) : order_id(order_id), items(items) {}
-    vector<Item*> getItems() { return items; }
+    Order() {}
+    Order(int order_id, const vector<Item*>& items) : order_id(order_id), items(items) {}
+
+    // Reuses the item list's capacity when the pool hands this order out again
+    void init(PoolHandle h, int id, const vector<Item*>& orderItems) {
+        handle = h;
+        order_id = id;
+        items.assign(orderItems.begin(), orderItems.end());
+    }
+    const vector<Item*>& getItems() { return items; }
+    PoolHandle getHandle() { return handle; }
 };
 
 // ----------- Code Generation -----------
@@ -71,94 +176,732 @@ public:
     }
 };
 
+// Code = random 6-digit secret followed by the locker's 3-digit slot at its location.
+// The slot part makes codes unique among the active packages of a location by
+// construction (a locker holds one package), and lets the kiosk find the locker from
+// the code alone. The secret comes from the kernel CSPRNG, so there is no shared
+// generator state and packing threads never wait on each other.
+class SecureCodeGenration : public CodeGenration {
+    static const uint32_t range = 900000;
+    static const uint32_t limit = UINT32_MAX - UINT32_MAX % range;  // rejection keeps every secret equally likely
+
+    int slot;
+
+    static string formatCode(uint32_t value, int slot) {
+        return to_string((100000 + value % range) * (long long)kMaxLockersPerLocation + slot);
+    }
+public:
+    static const int kMaxLockersPerLocation = 1000;
+
+    SecureCodeGenration(int slot) : slot(slot) {}
+
+    string generateCode() override {
+        uint32_t value;
+        do {
+            while (getrandom(&value, sizeof(value), 0) != (ssize_t)sizeof(value)) {}
+        } while (value >= limit);
+        return formatCode(value, slot);
+    }
+
+    // Codes for a whole batch of slots, drawing the randomness in one getrandom call
+    static vector<string> generateCodes(const vector<int>& slots) {
+        vector<uint32_t> values(slots.size());
+        vector<string> codes;
+        codes.reserve(slots.size());
+        size_t next = values.size();
+        for (int slot : slots) {
+            uint32_t value;
+            do {
+                if (next == values.size()) {
+                    size_t filled = 0;
+                    while (filled < values.size() * sizeof(uint32_t)) {
+                        ssize_t n = getrandom((char*)values.data() + filled, values.size() * sizeof(uint32_t) - filled, 0);
+                        if (n > 0) filled += n;
+                    }
+                    next = 0;
+                }
+                value = values[next++];
+            } while (value >= limit);
+            codes.push_back(formatCode(value, slot));
+        }
+        return codes;
+    }
+
+    // The locker slot encoded in a code, or -1 if it is not a well-formed code
+    static int slotOf(const string& code) {
+        if (code.size() != 9 || code.find_first_not_of("0123456789") != string::npos) return -1;
+        return stoi(code.substr(6));
+    }
+};
+
 // ----------- Package -----------
 
 class Package {
-    int package_id;
-    Order* order;
-    PackageSize packageSize;
+    int package_id = 0;
+    Order* order = nullptr;
+    PackageSize packageSize = PackageSize::SMALL;
+protected:
+    void init(int id, Order* packageOrder, PackageSize size) {
+        package_id = id;
+        order = packageOrder;
+        packageSize = size;
+    }
 public:
+    Package() {}
     Package(int package_id, Order* order, PackageSize size)
         : package_id(package_id), order(order), packageSize(size) {}
 
     virtual void pack() {}
+    int getPackageId() { return package_id; }
     PackageSize getPackageSize() { return packageSize; }
     Order* getOrder() { return order; }
 };
 
 class LockerPackage : public Package {
     string code;
-    time_t validity_till;
-    int locker_id;
-    CodeGenration* codegen;
+    atomic<uint64_t> codeKey{0};  // the code in numeric form, readable while another thread repacks
+    PoolHandle handle;
+
+    // Exact for codes of up to 17 digits, which every generator here produces; 0 never matches
+    static uint64_t keyOf(const string& code) {
+        if (code.empty() || code.size() > 17 || code.find_first_not_of("0123456789") != string::npos) return 0;
+        return stoull(code) << 5 | code.size();
+    }
+    time_t validity_till = 0;
+    int locker_id = 0;
+    CodeGenration* codegen = nullptr;
 public:
+    LockerPackage() {}
     LockerPackage(int package_id, Order* order, PackageSize size,
                   int locker_id, time_t valid_till, CodeGenration* gen)
         : Package(package_id, order, size), locker_id(locker_id),
           validity_till(valid_till), codegen(gen) {}
 
+    void init(PoolHandle h, int package_id, Order* order, PackageSize size,
+              int locker, time_t valid_till, CodeGenration* gen) {
+        Package::init(package_id, order, size);
+        handle = h;
+        code.clear();
+        codeKey.store(0, memory_order_relaxed);
+        locker_id = locker;
+        validity_till = valid_till;
+        codegen = gen;
+    }
+
     void pack() override {
         this->code = codegen->generateCode();
+        codeKey.store(keyOf(code), memory_order_relaxed);
+        codegen = nullptr;  // only needed while packing; callers may pass a short-lived generator
+    }
+
+    // Used by bulk packing, where codes for the whole manifest are generated up front
+    void assignCode(const string& bulkCode) {
+        code = bulkCode;
+        codeKey.store(keyOf(code), memory_order_relaxed);
     }
 
     bool validateCode(const string& inputCode) { return inputCode == code; }
+    // Safe to call on a package another thread may be releasing; see Locker::pickUpPackage
+    bool matchesCode(const string& inputCode) {
+        uint64_t key = keyOf(inputCode);
+        return key != 0 && key == codeKey.load(memory_order_relaxed);
+    }
     string getCode() { return code; }
+    time_t getValidTill() { return validity_till; }
+    PoolHandle getHandle() { return handle; }
+};
+
+// ----------- Order Store -----------
+
+// Owns every item, order and package. An order owns its items and a package its
+// order, so releasing a package ends the lifetime of the whole chain. Anything that
+// outlives a package's pickup (e.g. the expiry wheel) keeps its handle, not a pointer.
+class OrderStore {
+    SlotPool<Item> items;
+    SlotPool<Order> orders;
+    SlotPool<LockerPackage> packages;
+
+    OrderStore() {}
+public:
+    static OrderStore& getInstance() {
+        static OrderStore instance;
+        return instance;
+    }
+
+    Item* newItem(int itemId, int quantity) {
+        PoolHandle handle;
+        Item* item = items.acquire(handle);
+        if (item) item->init(handle, itemId, quantity);
+        return item;
+    }
+
+    Order* newOrder(int orderId, const vector<Item*>& orderItems) {
+        PoolHandle handle;
+        Order* order = orders.acquire(handle);
+        if (order) order->init(handle, orderId, orderItems);
+        return order;
+    }
+
+    LockerPackage* newPackage(int packageId, Order* order, PackageSize size, int lockerId,
+                              time_t validTill, CodeGenration* gen) {
+        PoolHandle handle;
+        LockerPackage* pkg = packages.acquire(handle);
+        if (pkg) pkg->init(handle, packageId, order, size, lockerId, validTill, gen);
+        return pkg;
+    }
+
+    LockerPackage* getPackage(PoolHandle handle) { return packages.get(handle); }
+
+    void releaseItems(const vector<Item*>& orderItems) {
+        for (Item* item : orderItems) items.release(item->getHandle());
+    }
+
+    void releaseOrder(Order* order) {
+        releaseItems(order->getItems());
+        orders.release(order->getHandle());
+    }
+
+    // Once the package is collected or returned to sender
+    void releasePackage(LockerPackage* pkg) {
+        if (pkg->getOrder()) releaseOrder(pkg->getOrder());
+        packages.release(pkg->getHandle());
+    }
+};
+
+// ----------- Telemetry -----------
+
+// One locker status change. Kept to 16 bytes so a year of events for thousands of
+// locations stays replayable in memory.
+struct LockerEvent {
+    enum Kind : uint8_t { DEPOSIT, PICKUP, EXPIRE };
+
+    uint32_t at;        // unix seconds
+    int32_t locationId;
+    int32_t dwell;      // seconds the package spent in the locker, PICKUP and EXPIRE only
+    uint8_t size;       // LockerSize
+    Kind kind;
+};
+
+// Bounded ring of one location's events. Recorders claim a cell with a CAS on the tail
+// and publish it by bumping the cell's sequence, so recording takes no lock and memory
+// stays fixed however long nobody drains. Draining is serialized by a per-ring lock.
+class LockerEventBuffer {
+    static const uint64_t kCapacity = 1024;  // power of two
+
+    struct Cell {
+        atomic<uint64_t> sequence;  // == position when free, position + 1 once published
+        LockerEvent event;
+    };
+    Cell cells[kCapacity];
+    atomic<uint64_t> tail{0};
+    mutex drainLock;
+    uint64_t head = 0;  // guarded by drainLock
+public:
+    LockerEventBuffer() {
+        for (uint64_t i = 0; i < kCapacity; i++) cells[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    // False when the ring is full
+    bool tryPush(const LockerEvent& event) {
+        uint64_t pos = tail.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (kCapacity - 1)];
+            int64_t lag = (int64_t)(cell.sequence.load(memory_order_acquire) - pos);
+            if (lag < 0) return false;
+            if (lag > 0) {
+                pos = tail.load(memory_order_relaxed);
+            } else if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                cell.event = event;
+                cell.sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    // Moves the published events to `out`, oldest first, and runs `then` before letting
+    // the next drain in, so batches taken from one ring are handed on in order
+    template <typename Then>
+    void drainTo(vector<LockerEvent>& out, Then then) {
+        lock_guard<mutex> guard(drainLock);
+        while (true) {
+            Cell& cell = cells[head & (kCapacity - 1)];
+            if (cell.sequence.load(memory_order_acquire) != head + 1) break;
+            out.push_back(cell.event);
+            cell.sequence.store(head + kCapacity, memory_order_release);
+            head++;
+        }
+        then();
+    }
+    void drainTo(vector<LockerEvent>& out) { drainTo(out, [] {}); }
+};
+
+// Collects the per-location rings for offline planning. Recording never goes through
+// here unless a location's ring is full; the recorder then drains that ring into the
+// spill file with a single append and retries. Without a spill file the overflowing
+// event is dropped and counted, so memory stays bounded either way.
+class LockerEventLog {
+    mutex lock;  // guards the ring list only
+    vector<LockerEventBuffer*> buffers;
+    int spillFd = -1;
+    atomic<long long> dropped{0};
+
+    LockerEventLog() {}
+public:
+    static LockerEventLog& getInstance() {
+        static LockerEventLog instance;
+        return instance;
+    }
+
+    ~LockerEventLog() {
+        if (spillFd >= 0) ::close(spillFd);
+    }
+
+    void addBuffer(LockerEventBuffer* buffer) {
+        lock_guard<mutex> guard(lock);
+        buffers.push_back(buffer);
+    }
+
+    void removeBuffer(LockerEventBuffer* buffer) {
+        lock_guard<mutex> guard(lock);
+        buffers.erase(remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+    }
+
+    // Call before traffic starts; full rings are appended to `path` from then on
+    bool setSpillFile(const string& path) {
+        spillFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        return spillFd >= 0;
+    }
+
+    // Called by a recorder that found `buffer` full
+    void spill(LockerEventBuffer& buffer, const LockerEvent& event) {
+        if (spillFd < 0) {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        // The event itself still goes through the ring, behind anything recorded before it.
+        // A drain can come back empty while another recorder is between claiming the
+        // oldest cell and publishing it, which only takes a moment.
+        do {
+            vector<LockerEvent> batch;
+            buffer.drainTo(batch, [&]() {
+                size_t bytes = batch.size() * sizeof(LockerEvent);
+                if (bytes && write(spillFd, batch.data(), bytes) != (ssize_t)bytes) {
+                    dropped.fetch_add(batch.size(), memory_order_relaxed);
+                }
+            });
+            if (batch.empty()) this_thread::yield();
+        } while (!buffer.tryPush(event));
+    }
+
+    // Drains every ring. Each location's events come out oldest first and after anything
+    // it spilled earlier, which is the order the planner replays them in.
+    vector<LockerEvent> takeEvents() {
+        lock_guard<mutex> guard(lock);
+        vector<LockerEvent> result;
+        for (LockerEventBuffer* buffer : buffers) buffer->drainTo(result);
+        return result;
+    }
+
+    long long getDropped() { return dropped.load(memory_order_relaxed); }
+
+    // Events spilled to `path`, to be replayed ahead of takeEvents()
+    static vector<LockerEvent> readSpillFile(const string& path) {
+        vector<LockerEvent> events;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return events;
+        LockerEvent chunk[1024];
+        ssize_t n;
+        while ((n = read(fd, chunk, sizeof(chunk))) > 0) events.insert(events.end(), chunk, chunk + n / sizeof(LockerEvent));
+        ::close(fd);
+        return events;
+    }
 };
 
 // ----------- Locker -----------
 
+class LockerLocation;
+
+// Status and package live in one atomic word, so every deposit, pickup, expiry and
+// closure is a single CAS and no two of them can both succeed from the same state.
+// The transition itself takes no lock; handing the locker back to its location's
+// free pool afterwards takes that size's pool lock.
+// Lockers hold pooled packages only (see OrderStore); the package's generation in
+// the word means a stale handle can never match a later package in the same slot.
 class Locker {
+    static const uint64_t kIndexMask = (1u << 30) - 1;  // all ones = no package
+
     int id;
     LockerSize size;
-    LockerStatus status;
-    LockerPackage* package = nullptr;
+    atomic<uint64_t> state;  // bits 0-1 status, 2-31 package slot, 32-63 package generation
+    LockerLocation* location = nullptr;
+    int slot = -1;  // index within its location, part of every pickup code
+    atomic<time_t> depositedAt{0};
+    bool pooled = false;  // in its location's free pool, guarded by that pool's lock
+
+    static uint64_t stateWord(LockerStatus status, PoolHandle pkg) {
+        return (uint64_t)pkg.generation << 32 | (uint64_t)(pkg.index & kIndexMask) << 2 | (uint64_t)status;
+    }
+    static LockerStatus statusOf(uint64_t word) { return static_cast<LockerStatus>(word & 3); }
+    static PoolHandle packageOf(uint64_t word) {
+        uint32_t index = (word >> 2) & kIndexMask;
+        return index == kIndexMask ? PoolHandle() : PoolHandle{index, (uint32_t)(word >> 32)};
+    }
+
+    void finishRemoval(LockerEvent::Kind kind, time_t since);
 public:
     Locker(int id, LockerSize size, LockerStatus status)
-        : id(id), size(size), status(status) {}
+        : id(id), size(size), state(stateWord(status, PoolHandle())) {}
 
     LockerSize getSize() { return size; }
-    LockerStatus getStatus() { return status; }
+    LockerStatus getStatus() { return statusOf(state.load(memory_order_acquire)); }
     int getId() { return id; }
+    int getSlot() { return slot; }
+    void setLocation(LockerLocation* loc, int index) { location = loc; slot = index; }
 
-    bool isAvailable() { return status == LockerStatus::AVAILABLE; }
+    bool isAvailable() { return getStatus() == LockerStatus::AVAILABLE; }
+    bool isPooled() { return pooled; }
+    void setPooled(bool value) { pooled = value; }
 
-    void placePackage(LockerPackage* pkg) {
-        package = pkg;
-        status = LockerStatus::BOOKED;
-    }
-
-    LockerPackage* pickUpPackage(string code) {
-        if (!package || !package->validateCode(code)) return nullptr;
-        LockerPackage* ret = package;
-        package = nullptr;
-        status = LockerStatus::AVAILABLE;
-        return ret;
-    }
+    // AVAILABLE -> BOOKED; false if the locker was not available
+    bool placePackage(LockerPackage* pkg);
+    // BOOKED -> AVAILABLE for the holder of the code
+    LockerPackage* pickUpPackage(string code);
+    // BOOKED -> AVAILABLE if the locker still holds this package, e.g. when it expired
+    LockerPackage* reclaimPackage(PoolHandle pkg);
+    // AVAILABLE <-> CLOSED, for maintenance
+    bool close();
+    bool reopen();
 };
 
 // ----------- LockerLocation -----------
 
+// Position on the city grid, in km
+struct GeoPoint {
+    double x = 0, y = 0;
+
+    static double distance(const GeoPoint& a, const GeoPoint& b) {
+        return hypot(a.x - b.x, a.y - b.y);
+    }
+};
+
 class LockerLocation {
     int id;
+    GeoPoint position;
     vector<Locker*> lockers;
+
+    // Free lockers kept per size, each pool with its own lock so agents
+    // depositing different sizes at the same location don't contend
+    struct FreePool {
+        mutex lock;
+        vector<Locker*> lockers;
+    };
+    FreePool freePools[kLockerSizes];
+    // Mirrors the pool sizes so searches can check capacity without taking the pool locks.
+    // Closed lockers are taken out of their pool, so they are never counted.
+    atomic<int> freeCounts[kLockerSizes] = {};
+
+    // Running metrics per locker size, updated on every status change
+    struct SizeStats {
+        atomic<int> lockers{0}, occupied{0};
+        atomic<long long> deposits{0}, pickups{0}, expired{0}, dwellSeconds{0};
+    };
+    SizeStats stats[kLockerSizes];
+    LockerEventBuffer events;
+
+    void recordEvent(LockerSize size, LockerEvent::Kind kind, int dwell) {
+        // Stamped by the recorder itself; events racing within the same second may land
+        // out of order, which the planner's replay tolerates
+        LockerEvent event = {(uint32_t)time(nullptr), id, dwell, (uint8_t)size, kind};
+        if (!events.tryPush(event)) LockerEventLog::getInstance().spill(events, event);
+    }
 public:
-    LockerLocation(int id) : id(id) {}
+    LockerLocation(int id, GeoPoint position = GeoPoint()) : id(id), position(position) {
+        LockerEventLog::getInstance().addBuffer(&events);
+    }
+
+    ~LockerLocation() {
+        LockerEventLog::getInstance().removeBuffer(&events);
+    }
 
     void addLocker(Locker* locker) {
+        if ((int)lockers.size() >= SecureCodeGenration::kMaxLockersPerLocation) {
+            cout << "Location " << id << " cannot hold more lockers.\n";
+            return;
+        }
+        locker->setLocation(this, (int)lockers.size());
         lockers.push_back(locker);
+        stats[static_cast<int>(locker->getSize())].lockers.fetch_add(1, memory_order_relaxed);
+        if (locker->isAvailable()) releaseLocker(locker);
+    }
+
+    // Kiosk lookup: the locker a pickup code belongs to, in O(1). The code itself is
+    // still checked by the locker when the package is picked up.
+    Locker* findLockerByCode(const string& code) {
+        int slot = SecureCodeGenration::slotOf(code);
+        if (slot < 0 || slot >= (int)lockers.size()) return nullptr;
+        return lockers[slot];
     }
 
+    // Takes the locker out of its free pool, so no other agent can be handed it.
+    // Tries the exact size first, then the next larger sizes.
     Locker* getAvailableLocker(PackageSize size) {
-        LockerSize reqSize = static_cast<LockerSize>(size);
-        for (auto& locker : lockers) {
-            if (locker->getSize() == reqSize && locker->isAvailable()) {
-                return locker;
+        for (int s = static_cast<int>(size); s < kLockerSizes; s++) {
+            FreePool& pool = freePools[s];
+            lock_guard<mutex> guard(pool.lock);
+            while (!pool.lockers.empty()) {
+                Locker* locker = pool.lockers.back();
+                pool.lockers.pop_back();
+                locker->setPooled(false);
+                freeCounts[s].fetch_sub(1, memory_order_relaxed);
+                if (locker->isAvailable()) return locker;
             }
         }
         return nullptr;
     }
 
+    // Reserves lockers for a whole manifest: every size pool is locked once for the exact
+    // matches, then packages left over spill into the next larger size. Result is in the
+    // order of `sizes`, with nullptr where nothing fits.
+    vector<Locker*> getAvailableLockers(const vector<PackageSize>& sizes) {
+        vector<Locker*> result(sizes.size(), nullptr);
+        vector<int> waiting[kLockerSizes];
+        // Filled from the back, so the earliest manifest lines are served first
+        for (int i = (int)sizes.size() - 1; i >= 0; i--) waiting[static_cast<int>(sizes[i])].push_back(i);
+        auto take = [&](int s, vector<int>& requests) {
+            FreePool& pool = freePools[s];
+            lock_guard<mutex> guard(pool.lock);
+            while (!requests.empty() && !pool.lockers.empty()) {
+                Locker* locker = pool.lockers.back();
+                pool.lockers.pop_back();
+                locker->setPooled(false);
+                freeCounts[s].fetch_sub(1, memory_order_relaxed);
+                if (!locker->isAvailable()) continue;
+                result[requests.back()] = locker;
+                requests.pop_back();
+            }
+        };
+        for (int s = 0; s < kLockerSizes; s++) {
+            if (!waiting[s].empty()) take(s, waiting[s]);
+        }
+        vector<int> spill;
+        for (int s = 0; s < kLockerSizes; s++) {
+            if (!spill.empty()) take(s, spill);
+            spill.insert(spill.begin(), waiting[s].begin(), waiting[s].end());
+        }
+        return result;
+    }
+
+    // Puts a locker back once it is emptied, or when a reservation is abandoned.
+    // A locker is never pooled twice, and a closed one stays out until reopen().
+    void releaseLocker(Locker* locker) {
+        int s = static_cast<int>(locker->getSize());
+        lock_guard<mutex> guard(freePools[s].lock);
+        if (locker->isPooled() || locker->getStatus() == LockerStatus::CLOSED) return;
+        locker->setPooled(true);
+        freePools[s].lockers.push_back(locker);
+        freeCounts[s].fetch_add(1, memory_order_relaxed);
+    }
+
+    // Takes a locker that was just closed out of its pool, if it is there
+    void dropLocker(Locker* locker) {
+        int s = static_cast<int>(locker->getSize());
+        FreePool& pool = freePools[s];
+        lock_guard<mutex> guard(pool.lock);
+        if (!locker->isPooled()) return;
+        pool.lockers.erase(find(pool.lockers.begin(), pool.lockers.end(), locker));
+        locker->setPooled(false);
+        freeCounts[s].fetch_sub(1, memory_order_relaxed);
+    }
+
+    // Free lockers a package of this size could go into, including larger ones
+    int getFreeLockers(PackageSize size) {
+        int total = 0;
+        for (int s = static_cast<int>(size); s < kLockerSizes; s++) total += freeCounts[s].load(memory_order_relaxed);
+        return total;
+    }
+
+    void recordDeposit(LockerSize size) {
+        SizeStats& s = stats[static_cast<int>(size)];
+        s.occupied.fetch_add(1, memory_order_relaxed);
+        s.deposits.fetch_add(1, memory_order_relaxed);
+        recordEvent(size, LockerEvent::DEPOSIT, 0);
+    }
+
+    void recordRemoval(LockerSize size, LockerEvent::Kind kind, int dwell) {
+        SizeStats& s = stats[static_cast<int>(size)];
+        s.occupied.fetch_sub(1, memory_order_relaxed);
+        (kind == LockerEvent::EXPIRE ? s.expired : s.pickups).fetch_add(1, memory_order_relaxed);
+        s.dwellSeconds.fetch_add(dwell, memory_order_relaxed);
+        recordEvent(size, kind, dwell);
+    }
+
+    int getLockerCount(LockerSize size) { return stats[static_cast<int>(size)].lockers.load(memory_order_relaxed); }
+
+    // Share of the lockers of this size holding a package right now
+    double getUtilization(LockerSize size) {
+        SizeStats& s = stats[static_cast<int>(size)];
+        int total = s.lockers.load(memory_order_relaxed);
+        return total ? (double)s.occupied.load(memory_order_relaxed) / total : 0;
+    }
+
+    // Mean seconds between deposit and pickup or expiry
+    double getAverageDwell(LockerSize size) {
+        SizeStats& s = stats[static_cast<int>(size)];
+        long long removed = s.pickups.load(memory_order_relaxed) + s.expired.load(memory_order_relaxed);
+        return removed ? (double)s.dwellSeconds.load(memory_order_relaxed) / removed : 0;
+    }
+
     int getId() { return id; }
+    const GeoPoint& getPosition() { return position; }
+};
+
+bool Locker::placePackage(LockerPackage* pkg) {
+    if (pkg->getHandle().isNull()) return false;
+    uint64_t expected = stateWord(LockerStatus::AVAILABLE, PoolHandle());
+    if (!state.compare_exchange_strong(expected, stateWord(LockerStatus::BOOKED, pkg->getHandle()), memory_order_acq_rel)) {
+        return false;
+    }
+    // Only the depositor writes the stamp, once the locker is theirs. The customer gets
+    // the code after this returns, so a pickup cannot read the stamp before it is set.
+    depositedAt.store(time(nullptr), memory_order_relaxed);
+    if (location) location->recordDeposit(size);
+    return true;
+}
+
+// The code is checked before the CAS, against a package that may meanwhile be picked up,
+// released and reused by someone else. That is harmless: once the package has left the
+// locker the word can never hold its handle again, so the CAS fails.
+LockerPackage* Locker::pickUpPackage(string code) {
+    uint64_t word = state.load(memory_order_acquire);
+    if (statusOf(word) != LockerStatus::BOOKED) return nullptr;
+    LockerPackage* pkg = OrderStore::getInstance().getPackage(packageOf(word));
+    if (!pkg || !pkg->matchesCode(code)) return nullptr;
+    time_t since = depositedAt.load(memory_order_relaxed);
+    if (!state.compare_exchange_strong(word, stateWord(LockerStatus::AVAILABLE, PoolHandle()), memory_order_acq_rel)) {
+        return nullptr;
+    }
+    finishRemoval(LockerEvent::PICKUP, since);
+    return pkg;
+}
+
+LockerPackage* Locker::reclaimPackage(PoolHandle pkg) {
+    uint64_t expected = stateWord(LockerStatus::BOOKED, pkg);
+    time_t since = depositedAt.load(memory_order_relaxed);
+    if (!state.compare_exchange_strong(expected, stateWord(LockerStatus::AVAILABLE, PoolHandle()), memory_order_acq_rel)) {
+        return nullptr;
+    }
+    finishRemoval(LockerEvent::EXPIRE, since);
+    return OrderStore::getInstance().getPackage(pkg);
+}
+
+void Locker::finishRemoval(LockerEvent::Kind kind, time_t since) {
+    if (!location) return;
+    location->recordRemoval(size, kind, (int)(time(nullptr) - since));
+    location->releaseLocker(this);
+}
+
+bool Locker::close() {
+    uint64_t expected = stateWord(LockerStatus::AVAILABLE, PoolHandle());
+    if (!state.compare_exchange_strong(expected, stateWord(LockerStatus::CLOSED, PoolHandle()), memory_order_acq_rel)) {
+        return false;
+    }
+    if (location) location->dropLocker(this);
+    return true;
+}
+
+bool Locker::reopen() {
+    uint64_t expected = stateWord(LockerStatus::CLOSED, PoolHandle());
+    if (!state.compare_exchange_strong(expected, stateWord(LockerStatus::AVAILABLE, PoolHandle()), memory_order_acq_rel)) {
+        return false;
+    }
+    if (location) location->releaseLocker(this);
+    return true;
+}
+
+// ----------- Package Expiry -----------
+
+// Hashed timer wheel of one-minute slots. Scheduling a package is an append to the slot
+// of its deadline and advancing the clock only visits the slots that came due, so the
+// cost stays O(1) per package however many are stored. Collected packages are not
+// removed from their slot; they are skipped when it fires.
+class PackageExpiryService {
+    static const int kTickSeconds = 60;
+    static const int kSlots = 4096;  // about 2.8 days per turn of the wheel
+
+    struct Entry {
+        PoolHandle package;  // resolves to nullptr once the package is collected and released
+        Locker* locker;
+        long long rounds;  // full turns left before the deadline
+    };
+
+    mutex lock;
+    vector<Entry> slots[kSlots];
+    long long currentTick = -1;
+    vector<LockerPackage*> returnToSender;
+    vector<Notification*> listeners;
+
+    PackageExpiryService() {}
+public:
+    static PackageExpiryService& getInstance() {
+        static PackageExpiryService instance;
+        return instance;
+    }
+
+    void addListener(Notification* listener) {
+        lock_guard<mutex> guard(lock);
+        listeners.push_back(listener);
+    }
+
+    void schedule(LockerPackage* pkg, Locker* locker) {
+        long long tick = (pkg->getValidTill() + kTickSeconds - 1) / kTickSeconds;
+        lock_guard<mutex> guard(lock);
+        if (currentTick < 0) currentTick = time(nullptr) / kTickSeconds;
+        long long ahead = max(tick - currentTick, 1LL);
+        slots[(currentTick + ahead) % kSlots].push_back({pkg->getHandle(), locker, (ahead - 1) / kSlots});
+    }
+
+    // Frees the lockers of every package that expired up to `now` and queues the
+    // packages for return to sender. Called periodically, e.g. once a minute.
+    void advance(time_t now) {
+        vector<pair<LockerPackage*, Locker*>> expired;
+        vector<Notification*> notify;
+        {
+            lock_guard<mutex> guard(lock);
+            long long target = now / kTickSeconds;
+            if (currentTick < 0) currentTick = target;
+            while (currentTick < target) {
+                currentTick++;
+                vector<Entry>& slot = slots[currentTick % kSlots];
+                vector<Entry> pending;
+                for (Entry& entry : slot) {
+                    if (entry.rounds > 0) {
+                        entry.rounds--;
+                        pending.push_back(entry);
+                    } else if (LockerPackage* pkg = entry.locker->reclaimPackage(entry.package)) {
+                        returnToSender.push_back(pkg);
+                        expired.push_back({pkg, entry.locker});
+                    }
+                }
+                slot.swap(pending);
+            }
+            notify = listeners;
+        }
+        for (auto& item : expired) {
+            for (Notification* listener : notify) {
+                listener->setNotification("Package " + to_string(item.first->getPackageId()) + " expired in locker #" +
+                                          to_string(item.second->getId()) + ", returning to sender");
+            }
+        }
+    }
+
+    // Packages waiting to be picked up by the carrier for return. The carrier
+    // releases them to the OrderStore once they are handed back.
+    vector<LockerPackage*> takeReturnToSender() {
+        lock_guard<mutex> guard(lock);
+        vector<LockerPackage*> result;
+        result.swap(returnToSender);
+        return result;
+    }
 };
 
 // ----------- Users -----------
@@ -183,11 +926,7 @@ public:
         }
     }
 
-    void collectPackage(Locker* locker, string code) {
-        LockerPackage* pkg = locker->pickUpPackage(code);
-        if (pkg) cout << "Customer collected package successfully!\n";
-        else cout << "Invalid code. Cannot collect package.\n";
-    }
+    void collectPackage(Locker* locker, string code);
 };
 
 class DeliveryAgent : public User {
@@ -195,9 +934,61 @@ class DeliveryAgent : public User {
 public:
     DeliveryAgent(int id, string email, string phone) : User(email, phone), agent_id(id) {}
 
-    void placePackageInLocker(Locker* locker, LockerPackage* pkg) {
-        locker->placePackage(pkg);
+    bool placePackageInLocker(Locker* locker, LockerPackage* pkg) {
+        if (!locker->placePackage(pkg)) {
+            cout << "Locker #" << locker->getId() << " is not available.\n";
+            return false;
+        }
+        PackageExpiryService::getInstance().schedule(pkg, locker);
         cout << "Delivery agent placed the package in locker #" << locker->getId() << endl;
+        return true;
+    }
+
+    // Which of the deposits went in; the rest found their locker taken or closed
+    vector<bool> placePackagesInLockers(const vector<pair<Locker*, LockerPackage*>>& deposits) {
+        PackageExpiryService& expiry = PackageExpiryService::getInstance();
+        vector<bool> placed(deposits.size());
+        int count = 0;
+        for (size_t i = 0; i < deposits.size(); i++) {
+            placed[i] = deposits[i].first->placePackage(deposits[i].second);
+            if (!placed[i]) continue;
+            expiry.schedule(deposits[i].second, deposits[i].first);
+            count++;
+        }
+        cout << "Delivery agent placed " << count << " packages\n";
+        return placed;
+    }
+};
+
+// ----------- Notification Queue -----------
+
+// Code notifications waiting to be sent. A bulk deposit enqueues all of its
+// notifications under one lock and flushes once its lockers are loaded; batches
+// other agents enqueued meanwhile go out with it.
+class CodeNotificationQueue {
+    mutex lock;
+    vector<pair<Customer*, string>> pending;
+
+    CodeNotificationQueue() {}
+public:
+    static CodeNotificationQueue& getInstance() {
+        static CodeNotificationQueue instance;
+        return instance;
+    }
+
+    void enqueueBatch(vector<pair<Customer*, string>>& batch) {
+        lock_guard<mutex> guard(lock);
+        if (pending.empty()) pending.swap(batch);
+        else pending.insert(pending.end(), batch.begin(), batch.end());
+    }
+
+    void flush() {
+        vector<pair<Customer*, string>> sending;
+        {
+            lock_guard<mutex> guard(lock);
+            sending.swap(pending);
+        }
+        for (auto& item : sending) item.first->receiveCode(item.second);
     }
 };
 
@@ -205,13 +996,28 @@ public:
 
 class OrderService {
 public:
-    static Order* createOrder(vector<Item*> items) {
-        return new Order(rand(), items);
+    static Item* createItem(int itemId, int quantity) {
+        return OrderStore::getInstance().newItem(itemId, quantity);
+    }
+
+    // The order takes ownership of its items
+    static Order* createOrder(const vector<Item*>& items) {
+        return OrderStore::getInstance().newOrder(rand(), items);
+    }
+
+    // For items that never made it into an order
+    static void releaseItems(const vector<Item*>& items) {
+        OrderStore::getInstance().releaseItems(items);
+    }
+
+    static void releaseOrder(Order* order) {
+        OrderStore::getInstance().releaseOrder(order);
     }
 
     static LockerPackage* packOrder(Order* order, Locker* locker, PackageSize size, CodeGenration* codegen) {
-        LockerPackage* pkg = new LockerPackage(rand(), order, size, locker->getId(), system_clock::to_time_t(system_clock::now()) + 86400, codegen);
-        pkg->pack();
+        LockerPackage* pkg = OrderStore::getInstance().newPackage(rand(), order, size, locker->getId(),
+                                                                  system_clock::to_time_t(system_clock::now()) + 86400, codegen);
+        if (pkg) pkg->pack();
         return pkg;
     }
 
@@ -220,11 +1026,29 @@ public:
     }
 };
 
+void Customer::collectPackage(Locker* locker, string code) {
+    LockerPackage* pkg = locker->pickUpPackage(code);
+    if (pkg) {
+        OrderStore::getInstance().releasePackage(pkg);
+        cout << "Customer collected package successfully!\n";
+    } else {
+        cout << "Invalid code. Cannot collect package.\n";
+    }
+}
+
 // ----------- Locker Management System -----------
 
 class LockerManagementSystem {
     unordered_map<int, LockerLocation*> locations;
 
+    // Locations bucketed into square cells of the city grid for nearest-location search
+    static constexpr double kCellSize = 1.0;  // km
+    unordered_map<long long, vector<LockerLocation*>> cells;
+    int minCol = 0, maxCol = -1, minRow = 0, maxRow = -1;
+
+    static int cellOf(double coordinate) { return (int)floor(coordinate / kCellSize); }
+    static long long cellKey(int col, int row) { return ((long long)col << 32) | (unsigned int)row; }
+
     LockerManagementSystem() {}
 public:
     static LockerManagementSystem& getInstance() {
@@ -234,35 +1058,298 @@ public:
 
     void addLocation(LockerLocation* loc) {
         locations[loc->getId()] = loc;
+        int col = cellOf(loc->getPosition().x), row = cellOf(loc->getPosition().y);
+        cells[cellKey(col, row)].push_back(loc);
+        if (maxCol < minCol) {
+            minCol = maxCol = col;
+            minRow = maxRow = row;
+        } else {
+            minCol = min(minCol, col); maxCol = max(maxCol, col);
+            minRow = min(minRow, row); maxRow = max(maxRow, row);
+        }
     }
 
     LockerLocation* getLocation(int id) {
         return locations.count(id) ? locations[id] : nullptr;
     }
+
+    const unordered_map<int, LockerLocation*>& getLocations() { return locations; }
+
+    // Up to k locations closest to `from` that have a free locker for the package size,
+    // nearest first. Cells are visited in rings around `from`; the search stops once no
+    // further ring can hold anything closer than the k-th location found so far.
+    vector<LockerLocation*> findNearestLocations(const GeoPoint& from, PackageSize size, int k) {
+        if (k <= 0) return {};
+        vector<pair<double, LockerLocation*>> found;
+        int col = cellOf(from.x), row = cellOf(from.y);
+        int maxRing = max(max(abs(col - minCol), abs(col - maxCol)), max(abs(row - minRow), abs(row - maxRow)));
+        for (int ring = 0; ring <= maxRing; ring++) {
+            for (int c = col - ring; c <= col + ring; c++) {
+                for (int r = row - ring; r <= row + ring; r++) {
+                    if (abs(c - col) != ring && abs(r - row) != ring) continue;
+                    auto cell = cells.find(cellKey(c, r));
+                    if (cell == cells.end()) continue;
+                    for (LockerLocation* loc : cell->second) {
+                        if (loc->getFreeLockers(size) > 0) {
+                            found.push_back({GeoPoint::distance(from, loc->getPosition()), loc});
+                        }
+                    }
+                }
+            }
+            if ((int)found.size() >= k) {
+                nth_element(found.begin(), found.begin() + (k - 1), found.end());
+                if (found[k - 1].first <= ring * kCellSize) break;
+            }
+        }
+        size_t keep = min(found.size(), (size_t)k);
+        partial_sort(found.begin(), found.begin() + keep, found.end());
+        vector<LockerLocation*> result;
+        for (size_t i = 0; i < keep; i++) result.push_back(found[i].second);
+        return result;
+    }
+};
+
+// ----------- Capacity Planner -----------
+
+struct SizeMixRecommendation {
+    int locationId;
+    int current[kLockerSizes];
+    int recommended[kLockerSizes];
+    int demand[kLockerSizes];          // lockers busy at the planning percentile
+    double averageDwell[kLockerSizes]; // seconds
+};
+
+// Offline replay of the event log. Recommends, per location, how to split its current
+// locker count across sizes so each size covers its demand for `percentile` of the time.
+//
+// Aggregation runs on `threads` workers in two passes. First every worker scatters a
+// contiguous slice of the log into per-destination buckets by location. Then every
+// worker replays the buckets for its own locations, in slice order, so each location
+// sees its events in time order without any shared state or locking.
+class CapacityPlanner {
+    struct SizeReplay {
+        int occupied = 0;
+        uint32_t lastAt = 0;
+        vector<long long> secondsAt;  // time spent at each occupancy level
+        long long removals = 0, dwellSeconds = 0;
+    };
+    struct LocationReplay {
+        SizeReplay sizes[kLockerSizes];
+    };
+
+    double percentile;
+    int threads;
+
+    static void apply(SizeReplay& r, const LockerEvent& e) {
+        if (r.lastAt && e.at > r.lastAt) {
+            if ((int)r.secondsAt.size() <= r.occupied) r.secondsAt.resize(r.occupied + 1);
+            r.secondsAt[r.occupied] += e.at - r.lastAt;
+        }
+        r.lastAt = max(r.lastAt, e.at);  // a late, out-of-order event must not rewind the clock
+        if (e.kind == LockerEvent::DEPOSIT) {
+            r.occupied++;
+        } else {
+            r.occupied = max(r.occupied - 1, 0);  // the log may start with packages already placed
+            r.removals++;
+            r.dwellSeconds += e.dwell;
+        }
+    }
+
+    int demandOf(const SizeReplay& r) const {
+        long long total = 0;
+        for (long long seconds : r.secondsAt) total += seconds;
+        if (total == 0) return r.occupied;
+        long long covered = 0;
+        for (int level = 0; level < (int)r.secondsAt.size(); level++) {
+            covered += r.secondsAt[level];
+            if (covered >= percentile * total) return level;
+        }
+        return (int)r.secondsAt.size() - 1;
+    }
+
+    // Splits `total` lockers in proportion to demand, by largest remainder. Demand is met
+    // in full first when the location has room for it.
+    static void split(int total, const int demand[], int out[]) {
+        int demanded = 0;
+        for (int s = 0; s < kLockerSizes; s++) demanded += demand[s];
+        if (demanded == 0) return;
+        pair<double, int> remainders[kLockerSizes];
+        int assigned = 0;
+        for (int s = 0; s < kLockerSizes; s++) {
+            double share = demanded <= total ? demand[s] + (double)(total - demanded) * demand[s] / demanded
+                                             : (double)total * demand[s] / demanded;
+            out[s] = (int)share;
+            assigned += out[s];
+            remainders[s] = {share - out[s], s};
+        }
+        sort(remainders, remainders + kLockerSizes, greater<pair<double, int>>());
+        for (int i = 0; assigned < total; i++, assigned++) out[remainders[i % kLockerSizes].second]++;
+    }
+public:
+    CapacityPlanner(double percentile = 0.95, int threads = (int)max(1u, thread::hardware_concurrency()))
+        : percentile(percentile), threads(max(threads, 1)) {}
+
+    vector<SizeMixRecommendation> plan(const vector<LockerEvent>& events,
+                                       const unordered_map<int, LockerLocation*>& locations) {
+        int workers = threads;
+        size_t slice = (events.size() + workers - 1) / workers;
+
+        // Pass 1: scatter event indices by destination worker
+        vector<vector<vector<uint32_t>>> buckets(workers, vector<vector<uint32_t>>(workers));
+        vector<thread> pool;
+        for (int w = 0; w < workers; w++) {
+            pool.emplace_back([&, w]() {
+                size_t begin = min(events.size(), w * slice), end = min(events.size(), begin + slice);
+                for (size_t i = begin; i < end; i++) {
+                    buckets[w][(uint32_t)events[i].locationId % workers].push_back((uint32_t)i);
+                }
+            });
+        }
+        for (thread& t : pool) t.join();
+        pool.clear();
+
+        // Pass 2: replay each worker's locations
+        vector<unordered_map<int, LocationReplay>> replays(workers);
+        for (int w = 0; w < workers; w++) {
+            pool.emplace_back([&, w]() {
+                for (int source = 0; source < workers; source++) {
+                    for (uint32_t i : buckets[source][w]) {
+                        const LockerEvent& e = events[i];
+                        if (e.size < kLockerSizes) apply(replays[w][e.locationId].sizes[e.size], e);
+                    }
+                }
+            });
+        }
+        for (thread& t : pool) t.join();
+
+        vector<SizeMixRecommendation> result;
+        for (auto& entry : locations) {
+            LockerLocation* loc = entry.second;
+            SizeMixRecommendation rec = {};
+            rec.locationId = entry.first;
+            int total = 0;
+            for (int s = 0; s < kLockerSizes; s++) {
+                rec.current[s] = rec.recommended[s] = loc->getLockerCount(static_cast<LockerSize>(s));
+                total += rec.current[s];
+            }
+            auto& replay = replays[(uint32_t)entry.first % workers];
+            auto found = replay.find(entry.first);
+            if (found != replay.end()) {
+                for (int s = 0; s < kLockerSizes; s++) {
+                    const SizeReplay& r = found->second.sizes[s];
+                    rec.demand[s] = demandOf(r);
+                    rec.averageDwell[s] = r.removals ? (double)r.dwellSeconds / r.removals : 0;
+                }
+                split(total, rec.demand, rec.recommended);
+            }
+            result.push_back(rec);
+        }
+        return result;
+    }
 };
 
 // ----------- Main Simulation -----------
 
+// One line of a delivery agent's manifest
+struct DeliveryItem {
+    Customer* customer;
+    vector<Item*> items;
+    PackageSize size;
+};
+
 class LockerOrderSystem {
+    DeliveryAgent agent{101, "agent@delivery.com", "9876543210"};
 public:
-    void placeOrder(Customer* customer, vector<Item*> items, LockerLocation* location, PackageSize size) {
+    // Bulk deposit for an agent arriving with a whole manifest: one allocator pass,
+    // codes generated together, and all customer notifications sent as one batch.
+    // Returns the packages in manifest order, nullptr where no locker was free.
+    vector<LockerPackage*> placeOrders(DeliveryAgent* agent, LockerLocation* location, const vector<DeliveryItem>& manifest) {
+        vector<PackageSize> sizes;
+        for (const DeliveryItem& item : manifest) sizes.push_back(item.size);
+        vector<Locker*> lockers = location->getAvailableLockers(sizes);
+
+        vector<int> slots;
+        for (Locker* locker : lockers) {
+            if (locker) slots.push_back(locker->getSlot());
+        }
+        vector<string> codes = SecureCodeGenration::generateCodes(slots);
+
+        vector<LockerPackage*> packages(manifest.size(), nullptr);
+        vector<pair<Locker*, LockerPackage*>> deposits;
+        vector<size_t> depositLines;
+        time_t validTill = system_clock::to_time_t(system_clock::now()) + 86400;
+        size_t nextCode = 0;
+        for (size_t i = 0; i < manifest.size(); i++) {
+            if (!lockers[i]) {
+                OrderService::releaseItems(manifest[i].items);
+                continue;
+            }
+            const string& code = codes[nextCode++];
+            Order* order = OrderService::createOrder(manifest[i].items);
+            LockerPackage* pkg = order ? OrderStore::getInstance().newPackage(rand(), order, manifest[i].size,
+                                                                              lockers[i]->getId(), validTill, nullptr)
+                                       : nullptr;
+            if (!pkg) {
+                if (order) OrderService::releaseOrder(order);
+                else OrderService::releaseItems(manifest[i].items);
+                location->releaseLocker(lockers[i]);
+                continue;
+            }
+            pkg->assignCode(code);
+            deposits.push_back({lockers[i], pkg});
+            depositLines.push_back(i);
+        }
+
+        vector<bool> placed = agent->placePackagesInLockers(deposits);
+        vector<pair<Customer*, string>> notifications;
+        for (size_t d = 0; d < deposits.size(); d++) {
+            LockerPackage* pkg = deposits[d].second;
+            if (!placed[d]) {
+                OrderStore::getInstance().releasePackage(pkg);
+                continue;
+            }
+            packages[depositLines[d]] = pkg;
+            notifications.push_back({manifest[depositLines[d]].customer, pkg->getCode()});
+        }
+        CodeNotificationQueue& queue = CodeNotificationQueue::getInstance();
+        queue.enqueueBatch(notifications);
+        queue.flush();
+        return packages;
+    }
+
+    void placeOrder(Customer* customer, const vector<Item*>& items, LockerLocation* location, PackageSize size) {
         // 1. Create the order
         Order* order = OrderService::createOrder(items);
+        if (!order) {
+            cout << "Order store is full, try again later.\n";
+            OrderService::releaseItems(items);
+            return;
+        }
 
         // 2. Find an available locker
         Locker* locker = location->getAvailableLocker(size);
         if (!locker) {
             cout << "No available locker for the given package size.\n";
+            OrderService::releaseOrder(order);
             return;
         }
 
         // 3. Pack the order and generate the locker package
-        CodeGenration* gen = new RandomCodeGenration();
-        LockerPackage* pkg = OrderService::packOrder(order, locker, size, gen);
+        SecureCodeGenration gen(locker->getSlot());
+        LockerPackage* pkg = OrderService::packOrder(order, locker, size, &gen);
+        if (!pkg) {
+            cout << "Package store is full, try again later.\n";
+            OrderService::releaseOrder(order);
+            location->releaseLocker(locker);
+            return;
+        }
 
         // 4. Place the package in the locker
-        DeliveryAgent agent(101, "agent@delivery.com", "9876543210");
-        agent.placePackageInLocker(locker, pkg);
+        if (!agent.placePackageInLocker(locker, pkg)) {
+            OrderStore::getInstance().releasePackage(pkg);
+            location->releaseLocker(locker);
+            return;
+        }
 
         // 5. Send notification to the customer
         OrderService::sendNotification(customer, pkg->getCode());
@@ -272,12 +1359,160 @@ public:
     }
 };
 
-int main() {
+// ----------- Stress Test -----------
+
+// Races deposits, pickups, stale pickups, wrong codes, expiry reclaims and maintenance
+// closures on one small location from several threads, then checks that the history is
+// one a sequential locker could have produced: every package left its locker exactly
+// once, no wrong or stale code opened anything, and every locker ends up free and back
+// in its pool exactly once.
+class LockerStressTest {
+    int threads;
+    long long rounds;  // per thread
+    static const int kLockers = 16;
+
+    LockerLocation location{0};
+    vector<Locker*> lockers;
+    vector<string> codes;          // by deposit number
+    vector<PoolHandle> handles;
+    vector<atomic<int>> removals;  // successful pickups and reclaims per deposit
+    atomic<long long> nextDeposit{0};
+    atomic<long long> board[kLockers] = {};  // deposit number + 1 last placed in each slot
+    atomic<long long> pickups{0}, reclaims{0}, refused{0}, violations{0};
+    // Closures in progress and completed, so a deposit can tell whether one raced it
+    atomic<int> maintenance{0};
+    atomic<long long> closures{0};
+
+    void remove(long long deposit, LockerPackage* pkg, atomic<long long>& counter) {
+        if (removals[deposit].fetch_add(1) != 0) violations++;
+        counter++;
+        OrderStore::getInstance().releasePackage(pkg);
+    }
+
+    void work(unsigned seed) {
+        mt19937 rng(seed);
+        vector<Item*> noItems;
+        for (long long r = 0; r < rounds; r++) {
+            if (rng() % 64 == 0) {
+                // Maintenance closes a locker wherever it is: pooled, handed to an agent or booked
+                Locker* locker = lockers[rng() % kLockers];
+                maintenance++;
+                if (locker->close() && !locker->reopen()) violations++;
+                if (location.getFreeLockers(PackageSize::SMALL) > kLockers) violations++;  // pooled twice
+                closures++;
+                maintenance--;
+                continue;
+            }
+            if (rng() % 2 == 0) {
+                long long closuresBefore = closures.load();
+                bool quiet = maintenance.load() == 0;
+                Locker* locker = location.getAvailableLocker(PackageSize::SMALL);
+                if (!locker) continue;
+                SecureCodeGenration gen(locker->getSlot());
+                Order* order = OrderService::createOrder(noItems);
+                LockerPackage* pkg = OrderService::packOrder(order, locker, PackageSize::SMALL, &gen);
+                if (!locker->placePackage(pkg)) {
+                    // Only a closure racing this deposit may take the locker away
+                    if (quiet && maintenance.load() == 0 && closures.load() == closuresBefore) violations++;
+                    OrderStore::getInstance().releasePackage(pkg);
+                    location.releaseLocker(locker);
+                    continue;
+                }
+                long long deposit = nextDeposit.fetch_add(1);
+                codes[deposit] = pkg->getCode();
+                handles[deposit] = pkg->getHandle();
+                board[locker->getSlot()].store(deposit + 1, memory_order_release);
+                continue;
+            }
+            int slot = rng() % kLockers;
+            long long posted = board[slot].load(memory_order_acquire);
+            if (!posted) continue;
+            long long deposit = posted - 1;
+            Locker* locker = location.findLockerByCode(codes[deposit]);
+            switch (rng() % 3) {
+                case 0: {
+                    string wrong = codes[deposit];
+                    wrong[0] = wrong[0] == '9' ? '1' : wrong[0] + 1;
+                    if (locker->pickUpPackage(wrong)) violations++;
+                    else refused++;
+                    break;
+                }
+                case 1:
+                    if (LockerPackage* pkg = locker->pickUpPackage(codes[deposit])) remove(deposit, pkg, pickups);
+                    break;
+                default:
+                    if (LockerPackage* pkg = locker->reclaimPackage(handles[deposit])) remove(deposit, pkg, reclaims);
+                    break;
+            }
+        }
+    }
+public:
+    LockerStressTest(int threads, long long rounds)
+        : threads(max(threads, 2)), rounds(rounds), codes(this->threads * rounds),
+          handles(this->threads * rounds), removals(this->threads * rounds) {}
+
+    bool run() {
+        for (int i = 0; i < kLockers; i++) {
+            lockers.push_back(new Locker(i, LockerSize::SMALL, LockerStatus::AVAILABLE));
+            location.addLocker(lockers.back());
+        }
+
+        // Maintenance on a pooled locker and on one an agent holds: closed lockers leave
+        // the free count, and reopening puts each back exactly once
+        lockers[0]->close();
+        Locker* held = location.getAvailableLocker(PackageSize::SMALL);
+        held->close();
+        location.releaseLocker(held);  // the agent gives up on the closed locker
+        if (location.getFreeLockers(PackageSize::SMALL) != kLockers - 2) violations++;
+        lockers[0]->reopen();
+        held->reopen();
+        if (location.getFreeLockers(PackageSize::SMALL) != kLockers) violations++;
+        auto start = steady_clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) workers.emplace_back(&LockerStressTest::work, this, 1000 + t);
+        for (thread& worker : workers) worker.join();
+        double seconds = duration<double>(steady_clock::now() - start).count();
+
+        // Drain what is still deposited, then every deposit must have left exactly once
+        for (int slot = 0; slot < kLockers; slot++) {
+            long long posted = board[slot].load();
+            if (!posted) continue;
+            Locker* locker = location.findLockerByCode(codes[posted - 1]);
+            if (LockerPackage* pkg = locker->pickUpPackage(codes[posted - 1])) remove(posted - 1, pkg, pickups);
+        }
+        long long deposits = nextDeposit.load();
+        for (long long d = 0; d < deposits; d++) {
+            if (removals[d].load() != 1) violations++;
+        }
+        if (location.getFreeLockers(PackageSize::SMALL) != kLockers) violations++;
+        if (location.getUtilization(LockerSize::SMALL) != 0) violations++;
+        // Every locker must come out of the pool exactly once
+        vector<Locker*> pooled;
+        while (Locker* locker = location.getAvailableLocker(PackageSize::SMALL)) pooled.push_back(locker);
+        sort(pooled.begin(), pooled.end());
+        if (pooled.size() != kLockers || unique(pooled.begin(), pooled.end()) != pooled.end()) violations++;
+        for (Locker* locker : pooled) location.releaseLocker(locker);
+
+        cout << "Stress: " << threads << " threads, " << deposits << " deposits, " << pickups << " pickups, "
+             << reclaims << " reclaims, " << refused << " wrong codes refused in " << seconds << " s\n";
+        cout << (violations ? "FAILED: " + to_string(violations) + " violations\n" : string("All transitions consistent\n"));
+        LockerEventLog::getInstance().takeEvents();
+        return violations == 0;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    // `--stress [rounds]` races lockers from several threads instead of the walkthrough below
+    if (argc > 1 && string(argv[1]) == "--stress") {
+        long long rounds = argc > 2 ? atoll(argv[2]) : 200000;
+        return LockerStressTest(max(4u, thread::hardware_concurrency()), rounds).run() ? 0 : 1;
+    }
+
     srand(time(nullptr));
     LockerManagementSystem& lms = LockerManagementSystem::getInstance();
 
     // Setup Locker locations and lockers
-    auto* location = new LockerLocation(1);
+    auto* location = new LockerLocation(1, GeoPoint{2.5, 4.0});
     location->addLocker(new Locker(101, LockerSize::SMALL, LockerStatus::AVAILABLE));
     location->addLocker(new Locker(102, LockerSize::MEDIUM, LockerStatus::AVAILABLE));
     lms.addLocation(location);
@@ -285,11 +1520,34 @@ int main() {
     // Customer places an order
     vector<Notification*> notifs = { new EmailNotification() };
     Customer customer(1, "vikas@example.com", "1234567890", notifs);
-    vector<Item*> items = { new Item(1, 2) };
+    vector<Item*> items = { OrderService::createItem(1, 2) };
+
+    // Checkout picks the nearest location with a free locker for the package
+    vector<LockerLocation*> nearby = lms.findNearestLocations(GeoPoint{3.0, 3.5}, PackageSize::SMALL, 1);
+    if (nearby.empty()) {
+        cout << "No locker location nearby has space for this package.\n";
+        return 0;
+    }
 
     // Place the order and simulate the full process
     LockerOrderSystem lockerOrderSystem;
-    lockerOrderSystem.placeOrder(&customer, items, location, PackageSize::SMALL);
+    lockerOrderSystem.placeOrder(&customer, items, nearby[0], PackageSize::SMALL);
+
+    // An agent arrives with a manifest and loads it in one pass; the codes go out together
+    DeliveryAgent courier(102, "courier@delivery.com", "9876500000");
+    Customer neighbour(2, "asha@example.com", "1234500000", { new MessageNotification() });
+    vector<DeliveryItem> manifest = {
+        {&customer, { OrderService::createItem(2, 1) }, PackageSize::SMALL},
+        {&neighbour, { OrderService::createItem(3, 1) }, PackageSize::MEDIUM},
+    };
+    vector<LockerPackage*> delivered = lockerOrderSystem.placeOrders(&courier, location, manifest);
+
+    // Each customer opens their locker with the code they were sent
+    for (size_t i = 0; i < delivered.size(); i++) {
+        if (!delivered[i]) continue;
+        string code = delivered[i]->getCode();
+        manifest[i].customer->collectPackage(location->findLockerByCode(code), code);
+    }
 
     return 0;
 }
@@ -1,3 +1,35 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
 // Enumeration
 enum PaymentStatus {
   COMPLETED, 
@@ -34,46 +66,108 @@ class Address {
     string country;
 };
 
+enum ParkingSpotType {
+  HANDICAPPED,
+  COMPACT,
+  LARGE,
+  MOTORCYCLE
+};
+
+const int kSpotTypes = 4;
+
+class Vehicle;
+class ParkingTicket;
+class DisplayBoard;
+class Entrance;
+class Exit;
+
+// Position of a spot or a gate inside the garage
+struct SpotLocation {
+  int level = 0;
+  int x = 0;
+  int y = 0;
+
+  // Changing level means driving a ramp, which costs as much as this many units on a floor
+  static const int kLevelCost = 100;
+
+  static int travelCost(const SpotLocation& a, const SpotLocation& b) {
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y) + kLevelCost * std::abs(a.level - b.level);
+  }
+};
+
 // ParkingSpot is an abstract class
 class ParkingSpot {
   private:
     int id;
-    bool isFree;
-    Vehicle vehicle; 
+    ParkingSpotType type;
+    SpotLocation location;
+    // Position in the lot's spot list, also the spot's record in the TicketStore
+    int index = -1;
+    // Spots are claimed with a CAS so two entrances can never hand out the same spot
+    std::atomic<bool> free{true};
+
+  protected:
+    Vehicle* vehicle = nullptr;
 
   public:
-    bool isFree(); 
-    virtual bool assignVehicle(Vehicle vehicle) = 0; 
+    ParkingSpot(int id, ParkingSpotType type, SpotLocation location)
+      : id(id), type(type), location(location) {}
+    virtual ~ParkingSpot() {}
+
+    int getId() const { return id; }
+    ParkingSpotType getType() const { return type; }
+    const SpotLocation& getLocation() const { return location; }
+    int getIndex() const { return index; }
+    void setIndex(int value) { index = value; }
+    bool isFree() const { return free.load(std::memory_order_acquire); }
+
+    // Returns true only for the caller that flipped the spot from free to taken
+    bool tryClaim() {
+      bool expected = true;
+      return free.compare_exchange_strong(expected, false, std::memory_order_acq_rel);
+    }
+
+    virtual bool assignVehicle(Vehicle* vehicle) = 0; 
     bool removeVehicle(){
-      // definition
+      vehicle = nullptr;
+      free.store(true, std::memory_order_release);
+      return true;
     } 
 };
 
 class Handicapped : public ParkingSpot {
   public:
-    bool assignVehicle(Vehicle vehicle) {
-        // definition
+    Handicapped(int id, SpotLocation location = SpotLocation()) : ParkingSpot(id, HANDICAPPED, location) {}
+    bool assignVehicle(Vehicle* vehicle) {
+        this->vehicle = vehicle;
+        return true;
     }
 };
 
 class Compact : public ParkingSpot {
   public:
-    bool assignVehicle(Vehicle vehicle) {
-        // definition
+    Compact(int id, SpotLocation location = SpotLocation()) : ParkingSpot(id, COMPACT, location) {}
+    bool assignVehicle(Vehicle* vehicle) {
+        this->vehicle = vehicle;
+        return true;
     }
 };
 
 class Large : public ParkingSpot {
   public: 
-    bool assignVehicle(Vehicle vehicle) {
-        // definition
+    Large(int id, SpotLocation location = SpotLocation()) : ParkingSpot(id, LARGE, location) {}
+    bool assignVehicle(Vehicle* vehicle) {
+        this->vehicle = vehicle;
+        return true;
     }
 };
 
 class Motorcycle : public ParkingSpot {
   public: 
-    bool assignVehicle(Vehicle vehicle) {
-        // definition
+    Motorcycle(int id, SpotLocation location = SpotLocation()) : ParkingSpot(id, MOTORCYCLE, location) {}
+    bool assignVehicle(Vehicle* vehicle) {
+        this->vehicle = vehicle;
+        return true;
     }
 };
 
@@ -81,37 +175,40 @@ class Motorcycle : public ParkingSpot {
 class Vehicle {
   private:
     string licenseNo;
+    ParkingTicket* ticket = nullptr;
 
   public:
-    void virtual assignTicket(ParkingTicket ticket) = 0; 
+    Vehicle(string licenseNo) : licenseNo(licenseNo) {}
+    virtual ~Vehicle() {}
+    const string& getLicenseNo() const { return licenseNo; }
+    void assignTicket(ParkingTicket* ticket) { this->ticket = ticket; }
+    ParkingTicket* getTicket() const { return ticket; }
+    // The kind of spot this vehicle has to be parked in
+    virtual ParkingSpotType getSpotType() = 0;
 };
 
 class Car : public Vehicle {
   public:
-    void assignTicket(ParkingTicket ticket) {
-        // definition
-    } 
+    Car(string licenseNo) : Vehicle(licenseNo) {}
+    ParkingSpotType getSpotType() { return COMPACT; }
 };
 
 class Van : public Vehicle {
   public:
-    void assignTicket(ParkingTicket ticket) {
-        // definition
-    } 
+    Van(string licenseNo) : Vehicle(licenseNo) {}
+    ParkingSpotType getSpotType() { return LARGE; }
 };
 
 class Truck : public Vehicle {
   public:
-    void assignTicket(ParkingTicket ticket) {
-        // definition
-    } 
+    Truck(string licenseNo) : Vehicle(licenseNo) {}
+    ParkingSpotType getSpotType() { return LARGE; }
 };
 
 class MotorCycle : public Vehicle {
   public:
-    void assignTicket(ParkingTicket ticket) {
-        // definition
-    } 
+    MotorCycle(string licenseNo) : Vehicle(licenseNo) {}
+    ParkingSpotType getSpotType() { return MOTORCYCLE; }
 };
 
 class Account {
@@ -129,17 +226,18 @@ class Account {
 class Admin : public Account {
   public: 
     // spot here refers to an instance of the ParkingSpot class
-    bool addParkingSpot(ParkingSpot spot);
+    bool addParkingSpot(ParkingSpot* spot);
     // displayBoard here refers to an instance of the DisplayBoard class
-    bool addDisplayBoard(DisplayBoard displayBoard);
+    bool addDisplayBoard(DisplayBoard* displayBoard);
     // entrance here refers to an instance of the Entrance class
-    bool addEntrance(Entrance entrance);
+    bool addEntrance(Entrance* entrance);
     // exit here refers to an instance of the Exit class
-    bool addExit(Exit exit;
+    bool addExit(Exit* exit);
   
     // Will implement the functionality in this class
     bool resetPassword() {
       // definition
+      return false;
     }
 };
 
@@ -150,6 +248,69 @@ class ParkingAttendant : public Account {
     // Will implement the functionality in this class
     bool resetPassword() {
       // definition
+      return false;
+    }
+};
+
+struct FreeSpotSnapshot {
+    int free[kSpotTypes];
+};
+
+// Free spot counts per floor and per type, plus a lot-wide row, kept up to date by
+// the ParkingLot on every claim and release. Each floor's row sits on its own cache
+// line so gates parking on different floors do not bounce the same line.
+class FreeSpotCounters {
+  private:
+    struct alignas(64) Row {
+      std::atomic<int> free[kSpotTypes];
+    };
+
+    int levels = 0;
+    std::unique_ptr<Row[]> rows;  // one per level, then the lot-wide totals
+    // Optional aggregate the lot-wide totals also feed, e.g. a city area in the registry
+    std::atomic<int>* parent = nullptr;
+
+    Row& totals() const { return rows[levels]; }
+
+  public:
+    void reset(int levelCount) {
+      levels = levelCount;
+      rows.reset(new Row[levelCount + 1]);
+      for (int level = 0; level <= levelCount; level++) {
+        for (int type = 0; type < kSpotTypes; type++) rows[level].free[type].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    int getLevels() const { return levels; }
+
+    // Adds the current totals to `parentCounters` (kSpotTypes of them) and keeps them in step from now on
+    void attachParent(std::atomic<int>* parentCounters) {
+      for (int type = 0; type < kSpotTypes; type++) {
+        parentCounters[type].fetch_add(totals().free[type].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+      parent = parentCounters;
+    }
+
+    void onRelease(int level, ParkingSpotType type) {
+      rows[level].free[type].fetch_add(1, std::memory_order_relaxed);
+      totals().free[type].fetch_add(1, std::memory_order_relaxed);
+      if (parent) parent[type].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void onClaim(int level, ParkingSpotType type) {
+      rows[level].free[type].fetch_sub(1, std::memory_order_relaxed);
+      totals().free[type].fetch_sub(1, std::memory_order_relaxed);
+      if (parent) parent[type].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    int total(ParkingSpotType type) const { return totals().free[type].load(std::memory_order_relaxed); }
+
+    // Pass a level, or -1 for the whole lot. Costs kSpotTypes atomic loads.
+    FreeSpotSnapshot snapshot(int level) const {
+      const Row& row = level < 0 ? totals() : rows[level];
+      FreeSpotSnapshot result;
+      for (int type = 0; type < kSpotTypes; type++) result.free[type] = row.free[type].load(std::memory_order_relaxed);
+      return result;
     }
 };
 
@@ -157,13 +318,21 @@ class DisplayBoard {
 // Data members
   private:
     int id;
-    std::vector<ParkingSpot*> parkingSpots;
+    int level;  // -1 for a board showing the whole lot, e.g. at an entrance
+    const FreeSpotCounters* counters;
 
   // Member functions
   public:
-    DisplayBoard(int id) : id(id) {}
-    void addParkingSpot(ParkingSpot* spot);
-    void showFreeSlot();
+    DisplayBoard(int id, int level, const FreeSpotCounters* counters) : id(id), level(level), counters(counters) {}
+
+    // Reads the shared counters, never walks the spots
+    void showFreeSlot() {
+      static const char* names[kSpotTypes] = {"Handicapped", "Compact", "Large", "Motorcycle"};
+      FreeSpotSnapshot snapshot = counters->snapshot(level);
+      cout << "Board " << id << ":";
+      for (int type = 0; type < kSpotTypes; type++) cout << " " << names[type] << "=" << snapshot.free[type];
+      cout << endl;
+    }
 };
 
 class ParkingRate {
@@ -177,43 +346,962 @@ class ParkingRate {
     void calculate();
 };
 
+struct RateSlab {
+    int upToHour;
+    double ratePerHour;
+};
+
+class IRateCalculator {
+  public:
+    // duration is in whole hours
+    virtual double calculateRate(int duration) = 0;
+};
+
+// Slabs are turned into per-minute prefix sums once, so pricing any duration is a
+// binary search over the slab boundaries instead of a walk over every slab
+class SlabTariff {
+  private:
+    vector<long long> startMinute;
+    vector<long long> endMinute;
+    vector<double> ratePerHour;
+    vector<double> costBefore;  // total charge for all minutes before startMinute[i]
+
+  public:
+    SlabTariff(const vector<RateSlab>& slabs) {
+      long long previous = 0;
+      double cost = 0;
+      for (const RateSlab& slab : slabs) {
+        long long end = slab.upToHour * 60LL;
+        startMinute.push_back(previous);
+        endMinute.push_back(end);
+        ratePerHour.push_back(slab.ratePerHour);
+        costBefore.push_back(cost);
+        cost += (end - previous) * slab.ratePerHour / 60.0;
+        previous = end;
+      }
+    }
+
+    double priceMinutes(long long minutes) const {
+      if (minutes <= 0 || startMinute.empty()) return 0;
+      // Last slab that starts before the duration ends
+      size_t i = std::upper_bound(startMinute.begin(), startMinute.end(), minutes - 1) - startMinute.begin() - 1;
+      long long billed = std::min(minutes, endMinute[i]) - startMinute[i];
+      return costBefore[i] + billed * ratePerHour[i] / 60.0;
+    }
+
+    // Prices a whole array of durations (in minutes). The loops are branch-free with the
+    // slabs on the outside, so the compiler can vectorize the inner loop over durations.
+    void priceBatch(const int* minutes, double* out, size_t count) const {
+      for (size_t j = 0; j < count; j++) out[j] = 0;
+      for (size_t i = 0; i < startMinute.size(); i++) {
+        const double start = (double)startMinute[i];
+        const double length = (double)(endMinute[i] - startMinute[i]);
+        const double rate = ratePerHour[i];
+        for (size_t j = 0; j < count; j++) {
+          double billed = (double)minutes[j] - start;
+          billed = billed < 0 ? 0 : billed;
+          billed = billed > length ? length : billed;
+          out[j] += billed * rate;
+        }
+      }
+      for (size_t j = 0; j < count; j++) out[j] /= 60.0;
+    }
+};
+
+// Multiplier for each minute of the day (e.g. cheaper nights), kept as a prefix sum
+// so the weighted length of any stay is computed in O(1), however long it is
+class TimeOfDayTariff {
+  private:
+    static const int kMinutesPerDay = 24 * 60;
+    double multiplier[kMinutesPerDay];
+    double weightBefore[kMinutesPerDay + 1];
+
+    void rebuild() {
+      weightBefore[0] = 0;
+      for (int m = 0; m < kMinutesPerDay; m++) weightBefore[m + 1] = weightBefore[m] + multiplier[m];
+    }
+
+    // Weighted minutes from minute-of-day `from` for `length` minutes, length < one day
+    double weightWithinDay(int from, int length) const {
+      int to = from + length;
+      if (to <= kMinutesPerDay) return weightBefore[to] - weightBefore[from];
+      return (weightBefore[kMinutesPerDay] - weightBefore[from]) + weightBefore[to - kMinutesPerDay];
+    }
+
+  public:
+    TimeOfDayTariff() {
+      std::fill(multiplier, multiplier + kMinutesPerDay, 1.0);
+      rebuild();
+    }
+
+    // Applies the multiplier to [fromHour, toHour), wrapping past midnight if toHour < fromHour
+    void setBand(int fromHour, int toHour, double value) {
+      for (int h = fromHour; h != toHour; h = (h + 1) % 24) {
+        std::fill(multiplier + h * 60, multiplier + (h + 1) * 60, value);
+      }
+      rebuild();
+    }
+
+    // Average multiplier over a stay, in lot local time
+    double averageMultiplier(time_t entry, long long minutes) const {
+      if (minutes <= 0) return 1.0;
+      tm local;
+      localtime_r(&entry, &local);
+      int from = local.tm_hour * 60 + local.tm_min;
+      double weight = (minutes / kMinutesPerDay) * weightBefore[kMinutesPerDay]
+                    + weightWithinDay(from, (int)(minutes % kMinutesPerDay));
+      return weight / minutes;
+    }
+};
+
+// Holds one precomputed slab tariff per spot type plus the time-of-day bands.
+// A stay is charged the slab price for its length, scaled by the average
+// time-of-day multiplier over the hours it actually covered.
+class ParkingRateEngine {
+  private:
+    std::unique_ptr<SlabTariff> tariffs[kSpotTypes];
+    TimeOfDayTariff timeOfDay;
+
+  public:
+    void setSlabs(ParkingSpotType type, const vector<RateSlab>& slabs) {
+      tariffs[type].reset(new SlabTariff(slabs));
+    }
+
+    void setTimeOfDayBand(int fromHour, int toHour, double multiplier) {
+      timeOfDay.setBand(fromHour, toHour, multiplier);
+    }
+
+    double price(ParkingSpotType type, time_t entry, time_t exit) const {
+      if (!tariffs[type]) return 0;
+      // Any started minute is billed
+      long long minutes = (exit - entry + 59) / 60;
+      return tariffs[type]->priceMinutes(minutes) * timeOfDay.averageMultiplier(entry, minutes);
+    }
+
+    // End-of-day reconciliation path: prices many stays at once, each given by its entry
+    // time and billed minutes, so it charges exactly what price() charged at the exit
+    void priceBatch(ParkingSpotType type, const time_t* entries, const int* minutes, double* out, size_t count) const {
+      if (!tariffs[type]) {
+        std::fill(out, out + count, 0.0);
+        return;
+      }
+      tariffs[type]->priceBatch(minutes, out, count);
+      for (size_t j = 0; j < count; j++) out[j] *= timeOfDay.averageMultiplier(entries[j], minutes[j]);
+    }
+};
+
+// Each Entrance reserves a block of ticket numbers from one shared atomic counter
+// and hands them out locally, so a gate only touches shared state once per block
+class TicketNumberRange {
+  private:
+    uint64_t next = 0;
+    uint64_t end = 0;
+
+  public:
+    static const uint64_t kBlockSize = 1024;
+
+    uint64_t nextNumber(std::atomic<uint64_t>& counter) {
+      if (next == end) {
+        next = counter.fetch_add(kBlockSize, std::memory_order_relaxed);
+        end = next + kBlockSize;
+      }
+      return next++;
+    }
+};
+
+class ParkingLot;
+
 class Entrance {
   // Data members 
   private:
     int id;
+    SpotLocation location;
+    // The lot this gate belongs to, set when the gate is added to it
+    ParkingLot* lot = nullptr;
+    // Owned by this gate only, so it needs no synchronization
+    TicketNumberRange ticketNumbers;
 
   // Member function
   public:
-    ParkingTicket getTicket(); 
+    Entrance(int id, SpotLocation location = SpotLocation()) : id(id), location(location) {}
+    int getId() const { return id; }
+    const SpotLocation& getLocation() const { return location; }
+    TicketNumberRange& getTicketNumbers() { return ticketNumbers; }
+    void setParkingLot(ParkingLot* parkingLot) { lot = parkingLot; }
+    ParkingTicket* getTicket(Vehicle* vehicle); 
 };
 
+class SettlementPipeline;
+
 class Exit {
   // Data members 
   private:
     int id; 
+    ParkingLot* lot;
+    SettlementPipeline* settlement;
 
   // Member function
   public:
-    void validateTicket(ParkingTicket ticket);{
-      // Perform validation logic for the parking ticket
-      // Calculate parking charges, if necessary
-      // Handle the exit process
+    Exit(int id, ParkingLot* lot, SettlementPipeline* settlement) : id(id), lot(lot), settlement(settlement) {}
+
+    // Computes the charge and hands the payment to the settlement pipeline.
+    // Returns true when the barrier may open.
+    bool validateTicket(uint64_t ticketNo, const string& accountId, time_t exitTime);
+    bool validateTicket(uint64_t ticketNo, const string& accountId) {
+      return validateTicket(ticketNo, accountId, time(nullptr));
     }
 };
 
 class ParkingTicket {
   private: 
-    int ticketNo;
+    uint64_t ticketNo;
+    ParkingSpot* spot;
+    string plate;  // normalized license plate
     time_t timestamp;
     time_t exit;
     double amount;
     bool status;
-  
-    // Following are the instances of their respective classes
-    Vehicle vehicle;
-    Payment payment;
-    Entrance entrance;
-    Exit exitIns;    
+
+  public:
+    ParkingTicket(uint64_t ticketNo, ParkingSpot* spot, const string& plate, time_t timestamp)
+      : ticketNo(ticketNo), spot(spot), plate(plate), timestamp(timestamp), exit(0), amount(0), status(true) {}
+
+    uint64_t getTicketNo() const { return ticketNo; }
+    ParkingSpot* getSpot() const { return spot; }
+    const string& getPlate() const { return plate; }
+    time_t getTimestamp() const { return timestamp; }
+};
+
+// Active tickets are spread over independently locked shards keyed by ticket number.
+// Consecutive numbers land on different shards, so gates issuing in parallel rarely
+// contend on the same lock.
+class ShardedTicketTable {
+  private:
+    static const int kShards = 16;
+
+    struct alignas(64) Shard {
+      std::mutex lock;
+      std::unordered_map<uint64_t, ParkingTicket*> tickets;
+    };
+    Shard shards[kShards];
+
+    Shard& shardFor(uint64_t ticketNo) { return shards[ticketNo % kShards]; }
+
+  public:
+    // Tickets still active when the table goes away are owned by it
+    ~ShardedTicketTable() {
+      for (auto& shard : shards) {
+        for (auto& entry : shard.tickets) delete entry.second;
+      }
+    }
+
+    void insert(ParkingTicket* ticket) {
+      Shard& shard = shardFor(ticket->getTicketNo());
+      std::lock_guard<std::mutex> guard(shard.lock);
+      shard.tickets[ticket->getTicketNo()] = ticket;
+    }
+
+    ParkingTicket* find(uint64_t ticketNo) {
+      Shard& shard = shardFor(ticketNo);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      auto it = shard.tickets.find(ticketNo);
+      return it == shard.tickets.end() ? nullptr : it->second;
+    }
+
+    ParkingTicket* remove(uint64_t ticketNo) {
+      Shard& shard = shardFor(ticketNo);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      auto it = shard.tickets.find(ticketNo);
+      if (it == shard.tickets.end()) return nullptr;
+      ParkingTicket* ticket = it->second;
+      shard.tickets.erase(it);
+      return ticket;
+    }
+
+    size_t size() {
+      size_t total = 0;
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        total += shard.tickets.size();
+      }
+      return total;
+    }
+};
+
+struct PlateEntry {
+    uint64_t ticketNo;  // 0 when the plate has no active ticket
+    ParkingSpot* spot;
+};
+
+// Normalized license plate -> active ticket and spot, for lost tickets, enforcement
+// and the ANPR cameras at every gate. Lock-striped like the ticket table; a plate can
+// only be present once, which is how duplicate entries are rejected.
+class PlateIndex {
+  private:
+    static const int kShards = 16;
+
+    struct alignas(64) Shard {
+      std::mutex lock;
+      std::unordered_map<string, PlateEntry> entries;
+    };
+    Shard shards[kShards];
+
+    static size_t shardOf(const string& plate) { return std::hash<string>()(plate) % kShards; }
+
+  public:
+    static const size_t kMaxPlateLength = 15;
+
+    // Upper-case letters and digits only, so "ka-01 ab 1234" and "KA01AB1234" match
+    static string normalize(const string& plate) {
+      string result;
+      for (char c : plate) {
+        if (std::isalnum((unsigned char)c) && result.size() < kMaxPlateLength) {
+          result.push_back((char)std::toupper((unsigned char)c));
+        }
+      }
+      return result;
+    }
+
+    // Returns false if the plate already has an active ticket
+    bool tryInsert(const string& plate, PlateEntry entry) {
+      Shard& shard = shards[shardOf(plate)];
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.entries.emplace(plate, entry).second;
+    }
+
+    void remove(const string& plate) {
+      Shard& shard = shards[shardOf(plate)];
+      std::lock_guard<std::mutex> guard(shard.lock);
+      shard.entries.erase(plate);
+    }
+
+    PlateEntry find(const string& plate) {
+      Shard& shard = shards[shardOf(plate)];
+      std::lock_guard<std::mutex> guard(shard.lock);
+      auto it = shard.entries.find(plate);
+      return it == shard.entries.end() ? PlateEntry{0, nullptr} : it->second;
+    }
+
+    // Camera ingest: looks up a whole frame batch of normalized plates, taking each shard lock once
+    void findBatch(const vector<string>& plates, vector<PlateEntry>& results) {
+      results.assign(plates.size(), PlateEntry{0, nullptr});
+      vector<int> byShard[kShards];
+      for (size_t i = 0; i < plates.size(); i++) byShard[shardOf(plates[i])].push_back((int)i);
+      for (int s = 0; s < kShards; s++) {
+        if (byShard[s].empty()) continue;
+        std::lock_guard<std::mutex> guard(shards[s].lock);
+        for (int i : byShard[s]) {
+          auto it = shards[s].entries.find(plates[i]);
+          if (it != shards[s].entries.end()) results[i] = it->second;
+        }
+      }
+    }
+};
+
+// Fixed-size records written straight into the mapped file, one per spot
+struct TicketStoreHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t spotCount;
+    // Entrances reserve ticket number blocks directly from here, so the counter survives a restart
+    std::atomic<uint64_t> nextTicketNo;
+};
+
+struct SpotRecord {
+    uint64_t ticketNo;
+    int64_t entryTime;
+    char plate[16];  // normalized, NUL-terminated
+    // Written last on issue and first on close, so a record is never seen half-filled
+    std::atomic<uint32_t> occupied;
+    uint32_t reserved;
+};
+
+enum TicketEventType {
+  TICKET_ISSUED,
+  TICKET_CLOSED
+};
+
+struct TicketEvent {
+    uint64_t ticketNo;
+    int64_t timestamp;
+    int32_t spotIndex;
+    int32_t type;
+};
+
+// First record of the event log, so a log left over from another format is not appended to
+struct TicketLogHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Persists spot occupancy and active tickets across restarts.
+// The snapshot is a memory-mapped array of SpotRecord, updated in place with a few
+// stores per ticket; every issue and close is also appended to a separate event log.
+// Reopening just remaps the file, there is nothing to parse. Both files carry the format
+// version, and a file from any other version is rejected rather than reinterpreted.
+class TicketStore {
+  private:
+    static const uint64_t kMagic = 0x504b4c4f54303031ULL;  // "PKLOT001"
+    static const uint64_t kLogMagic = 0x504b4c4f474c4f47ULL;  // "PKLOGLOG"
+    // 2: spot records carry the plate. 3: the event log starts with a TicketLogHeader.
+    static const uint32_t kVersion = 3;
+
+    int dataFd = -1;
+    int logFd = -1;
+    size_t mappedBytes = 0;
+    void* mapped = nullptr;
+    TicketStoreHeader* header = nullptr;
+    SpotRecord* records = nullptr;
+
+  public:
+    ~TicketStore() { close(); }
+
+    // Opens or creates `path` (and `path`.log) for a lot with `spotCount` spots.
+    // Fails if an existing file was written for a different spot layout or format version.
+    bool open(const string& path, uint32_t spotCount) {
+      // The log is checked first, so a rejected log never leaves a fresh snapshot behind
+      logFd = ::open((path + ".log").c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+      if (logFd < 0 || !checkLogHeader()) {
+        close();
+        return false;
+      }
+      dataFd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (dataFd < 0) {
+        close();
+        return false;
+      }
+      struct stat st;
+      fstat(dataFd, &st);
+      bool fresh = st.st_size == 0;
+      mappedBytes = sizeof(TicketStoreHeader) + spotCount * sizeof(SpotRecord);
+      if ((fresh && ftruncate(dataFd, mappedBytes) != 0) || (!fresh && (size_t)st.st_size != mappedBytes)) {
+        close();
+        return false;
+      }
+      mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, dataFd, 0);
+      if (mapped == MAP_FAILED) {
+        mapped = nullptr;
+        close();
+        return false;
+      }
+      header = static_cast<TicketStoreHeader*>(mapped);
+      records = reinterpret_cast<SpotRecord*>(header + 1);
+      if (fresh) {
+        // ftruncate zero-fills, so every spot starts out free
+        header->magic = kMagic;
+        header->version = kVersion;
+        header->spotCount = spotCount;
+        header->nextTicketNo.store(1);
+      } else if (header->magic != kMagic || header->version != kVersion || header->spotCount != spotCount) {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    // Writes the header into an empty log, or checks the one an existing log starts with
+    bool checkLogHeader() {
+      struct stat st;
+      fstat(logFd, &st);
+      TicketLogHeader logHeader = {kLogMagic, kVersion, 0};
+      if (st.st_size == 0) {
+        return write(logFd, &logHeader, sizeof(logHeader)) == (ssize_t)sizeof(logHeader);
+      }
+      TicketLogHeader existing;
+      return pread(logFd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+             existing.magic == kLogMagic && existing.version == kVersion;
+    }
+
+    void close() {
+      if (mapped) munmap(mapped, mappedBytes);
+      if (dataFd >= 0) ::close(dataFd);
+      if (logFd >= 0) ::close(logFd);
+      mapped = nullptr;
+      header = nullptr;
+      records = nullptr;
+      dataFd = logFd = -1;
+    }
+
+    bool isOpen() const { return mapped != nullptr; }
+    uint32_t getSpotCount() const { return header->spotCount; }
+    std::atomic<uint64_t>& ticketCounter() { return header->nextTicketNo; }
+    const SpotRecord& record(int spotIndex) const { return records[spotIndex]; }
+
+    void recordIssue(int spotIndex, uint64_t ticketNo, const string& plate, time_t entryTime) {
+      SpotRecord& rec = records[spotIndex];
+      rec.ticketNo = ticketNo;
+      rec.entryTime = entryTime;
+      std::strncpy(rec.plate, plate.c_str(), sizeof(rec.plate) - 1);
+      rec.plate[sizeof(rec.plate) - 1] = '\0';
+      rec.occupied.store(1, std::memory_order_release);
+      appendEvent(TICKET_ISSUED, spotIndex, ticketNo, entryTime);
+    }
+
+    void recordClose(int spotIndex, uint64_t ticketNo, time_t exitTime) {
+      records[spotIndex].occupied.store(0, std::memory_order_release);
+      appendEvent(TICKET_CLOSED, spotIndex, ticketNo, exitTime);
+    }
+
+    // A single write of a small record; O_APPEND keeps concurrent gates from interleaving
+    void appendEvent(TicketEventType type, int spotIndex, uint64_t ticketNo, time_t timestamp) {
+      TicketEvent event = {ticketNo, (int64_t)timestamp, spotIndex, type};
+      if (write(logFd, &event, sizeof(event)) != (ssize_t)sizeof(event)) {
+        cerr << "TicketStore: failed to append event for ticket " << ticketNo << endl;
+      }
+    }
+
+    // Forces the snapshot and the log to disk; the page cache already survives a process restart
+    void sync() {
+      msync(mapped, mappedBytes, MS_SYNC);
+      fsync(logFd);
+    }
+};
+
+// Two-level bitmap over spot ranks, rank 0 being the spot nearest to a gate.
+// The lowest set bit is the nearest free spot, found with a couple of word scans.
+// Summary bits may be stale (set while the leaf word is empty) and are cleaned up lazily.
+class FreeRankBitmap {
+  private:
+    size_t leafWords;
+    size_t summaryWords;
+    std::unique_ptr<std::atomic<uint64_t>[]> leaves;
+    std::unique_ptr<std::atomic<uint64_t>[]> summary;
+
+  public:
+    FreeRankBitmap(size_t ranks)
+      : leafWords((ranks + 63) / 64), summaryWords((leafWords + 63) / 64),
+        leaves(new std::atomic<uint64_t>[leafWords]), summary(new std::atomic<uint64_t>[summaryWords]) {
+      for (size_t i = 0; i < leafWords; i++) leaves[i].store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < summaryWords; i++) summary[i].store(0, std::memory_order_relaxed);
+      for (size_t rank = 0; rank < ranks; rank++) set(rank);
+    }
+
+    void set(size_t rank) {
+      leaves[rank / 64].fetch_or(1ULL << (rank % 64), std::memory_order_acq_rel);
+      summary[rank / 4096].fetch_or(1ULL << ((rank / 64) % 64), std::memory_order_acq_rel);
+    }
+
+    void clear(size_t rank) {
+      leaves[rank / 64].fetch_and(~(1ULL << (rank % 64)), std::memory_order_acq_rel);
+    }
+
+    // Returns the lowest set rank, or -1 if every rank is clear
+    long findFirst() {
+      for (size_t s = 0; s < summaryWords; s++) {
+        uint64_t summaryWord = summary[s].load(std::memory_order_acquire);
+        while (summaryWord != 0) {
+          int bit = __builtin_ctzll(summaryWord);
+          size_t leaf = s * 64 + bit;
+          uint64_t leafWord = leaves[leaf].load(std::memory_order_acquire);
+          if (leafWord == 0) {
+            // Drop the stale summary bit, then re-check in case a release raced with us
+            summary[s].fetch_and(~(1ULL << bit), std::memory_order_acq_rel);
+            leafWord = leaves[leaf].load(std::memory_order_acquire);
+            if (leafWord != 0) {
+              summary[s].fetch_or(1ULL << bit, std::memory_order_acq_rel);
+            }
+          }
+          if (leafWord != 0) {
+            return (long)(leaf * 64 + __builtin_ctzll(leafWord));
+          }
+          summaryWord &= summaryWord - 1;
+        }
+      }
+      return -1;
+    }
+};
+
+// Hands out the free spot of a given type closest to the entrance the vehicle used.
+// Every entrance keeps its own list of spots pre-sorted by travel cost and a bitmap of
+// which of them are free, so a lookup is a bitmap scan instead of a walk over all spots.
+// Built once when the lot opens; claims and releases after that are lock-free.
+class NearestSpotAllocator {
+  private:
+    struct GateView {
+      vector<int> order;   // rank -> spot slot, nearest first
+      vector<int> rankOf;  // spot slot -> rank
+      std::unique_ptr<FreeRankBitmap> free;
+    };
+
+    vector<ParkingSpot*> spotsOfType[kSpotTypes];
+    vector<GateView> views[kSpotTypes];  // one view per entrance
+    std::unordered_map<const ParkingSpot*, int> slotOf;
+    std::unordered_map<const Entrance*, int> gateOf;
+
+    void markTaken(ParkingSpotType type, int slot) {
+      for (GateView& view : views[type]) view.free->clear(view.rankOf[slot]);
+    }
+
+  public:
+    void build(const vector<ParkingSpot*>& spots, const vector<Entrance*>& entrances) {
+      for (int i = 0; i < (int)entrances.size(); i++) gateOf[entrances[i]] = i;
+      for (ParkingSpot* spot : spots) {
+        slotOf[spot] = (int)spotsOfType[spot->getType()].size();
+        spotsOfType[spot->getType()].push_back(spot);
+      }
+      for (int type = 0; type < kSpotTypes; type++) {
+        const vector<ParkingSpot*>& typed = spotsOfType[type];
+        views[type].resize(entrances.size());
+        for (size_t gate = 0; gate < entrances.size(); gate++) {
+          GateView& view = views[type][gate];
+          const SpotLocation& from = entrances[gate]->getLocation();
+          vector<int> cost(typed.size());
+          view.order.resize(typed.size());
+          for (size_t slot = 0; slot < typed.size(); slot++) {
+            cost[slot] = SpotLocation::travelCost(from, typed[slot]->getLocation());
+            view.order[slot] = (int)slot;
+          }
+          std::stable_sort(view.order.begin(), view.order.end(),
+                           [&](int a, int b) { return cost[a] < cost[b]; });
+          view.rankOf.resize(typed.size());
+          for (size_t rank = 0; rank < view.order.size(); rank++) view.rankOf[view.order[rank]] = (int)rank;
+          view.free.reset(new FreeRankBitmap(typed.size()));
+          for (size_t slot = 0; slot < typed.size(); slot++) {
+            if (!typed[slot]->isFree()) view.free->clear(view.rankOf[slot]);
+          }
+        }
+      }
+    }
+
+    ParkingSpot* claimNearest(ParkingSpotType type, const Entrance* entrance) {
+      auto gate = gateOf.find(entrance);
+      if (gate == gateOf.end()) return nullptr;
+      GateView& view = views[type][gate->second];
+      for (long rank = view.free->findFirst(); rank >= 0; rank = view.free->findFirst()) {
+        int slot = view.order[rank];
+        ParkingSpot* spot = spotsOfType[type][slot];
+        if (spot->tryClaim()) {
+          markTaken(type, slot);
+          return spot;
+        }
+        // Another gate won this spot, drop the hint unless the spot was freed again meanwhile
+        view.free->clear(rank);
+        if (spot->isFree()) view.free->set(rank);
+      }
+      return nullptr;
+    }
+
+    // The spot must already be marked free before its ranks are published again
+    void release(ParkingSpot* spot) {
+      int slot = slotOf.at(spot);
+      for (GateView& view : views[spot->getType()]) view.free->set(view.rankOf[slot]);
+    }
+};
+
+// Learns, per spot type, how many vehicles arrive in each hour of the day and how long
+// they stay, as exponentially weighted averages updated from ticket events. Gates only
+// bump atomic counters; the counts are folded into the averages once per hour.
+class OccupancyForecaster {
+  private:
+    static constexpr double kAlpha = 0.2;  // weight of the most recent hour
+    // One-sided z for a 5% risk of more guests showing up than there are reservable spots
+    static constexpr double kOverbookZ = 1.645;
+
+    std::atomic<long long> currentHour{-1};
+    std::atomic<int> arrivals[kSpotTypes];
+    std::atomic<int> departures[kSpotTypes];
+    std::atomic<long long> staySeconds[kSpotTypes];
+    std::atomic<int> shows{0};
+    std::atomic<int> noShows{0};
+
+    std::mutex foldLock;  // guards the averages below
+    double arrivalRate[kSpotTypes][24];
+    double meanStayHours[kSpotTypes];
+
+    void advance(time_t now) {
+      long long hour = now / 3600;
+      long long previous = currentHour.load(std::memory_order_acquire);
+      if (hour <= previous) return;
+      std::lock_guard<std::mutex> guard(foldLock);
+      previous = currentHour.load(std::memory_order_relaxed);
+      if (hour <= previous) return;
+      for (int type = 0; type < kSpotTypes; type++) {
+        int arrived = arrivals[type].exchange(0);
+        int departed = departures[type].exchange(0);
+        long long stayed = staySeconds[type].exchange(0);
+        if (previous < 0) continue;
+        double& rate = arrivalRate[type][previous % 24];
+        rate = (1 - kAlpha) * rate + kAlpha * arrived;
+        // Hours without a single event still count as zero arrivals
+        for (long long h = previous + 1; h < hour && h < previous + 24; h++) {
+          arrivalRate[type][h % 24] *= (1 - kAlpha);
+        }
+        if (departed > 0) {
+          meanStayHours[type] = (1 - kAlpha) * meanStayHours[type] + kAlpha * (stayed / 3600.0 / departed);
+        }
+      }
+      currentHour.store(hour, std::memory_order_release);
+    }
+
+  public:
+    OccupancyForecaster() {
+      for (int type = 0; type < kSpotTypes; type++) {
+        arrivals[type].store(0);
+        departures[type].store(0);
+        staySeconds[type].store(0);
+        std::fill(arrivalRate[type], arrivalRate[type] + 24, 0.0);
+        meanStayHours[type] = 0;
+      }
+    }
+
+    void onArrival(ParkingSpotType type, time_t now) {
+      advance(now);
+      arrivals[type].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void onDeparture(ParkingSpotType type, time_t entry, time_t exit) {
+      advance(exit);
+      departures[type].fetch_add(1, std::memory_order_relaxed);
+      staySeconds[type].fetch_add(exit - entry, std::memory_order_relaxed);
+    }
+
+    void onReservationOutcome(bool showed) {
+      (showed ? shows : noShows).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A check-in that was rolled back because no ticket could be issued
+    void retractShow() {
+      shows.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Shrunk towards zero until there is enough history, so a new lot does not overbook
+    double noShowRate() const {
+      double missed = noShows.load(std::memory_order_relaxed);
+      double total = missed + shows.load(std::memory_order_relaxed);
+      return missed / (total + 10);
+    }
+
+    // Expected walk-in occupancy (Little's law) at the busiest hour of [start, end)
+    double peakWalkIns(ParkingSpotType type, time_t start, time_t end) {
+      std::lock_guard<std::mutex> guard(foldLock);
+      double peak = 0;
+      for (time_t t = start - start % 3600; t < end && t < start + 24 * 3600; t += 3600) {
+        peak = std::max(peak, arrivalRate[type][(t / 3600) % 24] * meanStayHours[type]);
+      }
+      return peak;
+    }
+
+    // How many reservations may overlap in [start, end): the spots walk-ins are not
+    // expected to need, overbooked only as far as no-shows make it safe. Solves
+    // n*q + z*sqrt(n*p*q) <= spots for n, with p the no-show rate and q = 1 - p.
+    int reservableCapacity(ParkingSpotType type, time_t start, time_t end, int capacity) {
+      double spots = capacity - std::ceil(peakWalkIns(type, start, end));
+      if (spots <= 0) return 0;
+      double p = noShowRate();
+      double q = 1 - p;
+      double b = kOverbookZ * std::sqrt(p * q);
+      double root = (-b + std::sqrt(b * b + 4 * q * spots)) / (2 * q);
+      return std::max((int)spots, (int)std::floor(root * root));
+    }
+};
+
+// Range add / range max over time slots, so "how many reservations overlap this
+// window" is O(log slots). Lazy values are never pushed down: a node's max already
+// includes everything added to it.
+class CapacityTimeline {
+  private:
+    int size;
+    vector<int> maxHeld;
+    vector<int> added;
+
+    void update(int node, int l, int r, int from, int to, int delta) {
+      if (to <= l || r <= from) return;
+      if (from <= l && r <= to) {
+        maxHeld[node] += delta;
+        added[node] += delta;
+        return;
+      }
+      int mid = (l + r) / 2;
+      update(2 * node, l, mid, from, to, delta);
+      update(2 * node + 1, mid, r, from, to, delta);
+      maxHeld[node] = std::max(maxHeld[2 * node], maxHeld[2 * node + 1]) + added[node];
+    }
+
+    int query(int node, int l, int r, int from, int to) const {
+      if (to <= l || r <= from) return INT_MIN;
+      if (from <= l && r <= to) return maxHeld[node];
+      int mid = (l + r) / 2;
+      int best = std::max(query(2 * node, l, mid, from, to), query(2 * node + 1, mid, r, from, to));
+      return best == INT_MIN ? best : best + added[node];
+    }
+
+  public:
+    CapacityTimeline(int size) : size(size), maxHeld(4 * size, 0), added(4 * size, 0) {}
+
+    void add(int from, int to, int delta) { update(1, 0, size, from, to, delta); }
+    int maxIn(int from, int to) const { return std::max(0, query(1, 0, size, from, to)); }
+};
+
+// Holds capacity per spot type for time windows ahead of arrival.
+// Each type has a timeline of 15-minute slots used as a ring over the booking horizon;
+// a hold stays on it until the guest's window ends, or until the grace period after
+// the start passes without a check-in (a no-show). Every hold is eventually removed,
+// so slots are back at zero by the time the ring wraps onto them again.
+class ReservationEngine {
+  public:
+    static const int kSlotSeconds = 15 * 60;
+    static const int kHorizonSlots = 28 * 24 * 4;  // four weeks ahead
+    static const int kGraceSeconds = 30 * 60;
+
+  private:
+    struct Reservation {
+      ParkingSpotType type;
+      time_t start;
+      time_t end;
+      bool checkedIn;
+    };
+
+    struct Deadline {
+      time_t when;
+      uint64_t id;
+      bool operator>(const Deadline& other) const { return when > other.when; }
+    };
+
+    std::mutex lock;
+    vector<CapacityTimeline> timelines;
+    // The same holds, limited to reservations whose guest has not checked in yet
+    vector<CapacityTimeline> awaiting;
+    std::unordered_map<uint64_t, Reservation> reservations;
+    std::priority_queue<Deadline, vector<Deadline>, std::greater<Deadline>> deadlines;
+    uint64_t nextId = 1;
+    int capacity[kSpotTypes] = {0};
+    OccupancyForecaster* forecaster;
+
+    // What walk-in gates read without locking, recomputed whenever the engine changes
+    // or a new slot starts
+    std::atomic<long long> cachedSlot{-1};
+    std::atomic<int> outstanding[kSpotTypes];
+
+    static long long slotOf(time_t t) { return t / kSlotSeconds; }
+
+    static void hold(vector<CapacityTimeline>& on, const Reservation& r, int delta) {
+      long long first = slotOf(r.start);
+      long long last = slotOf(r.end - 1) + 1;
+      int from = (int)(first % kHorizonSlots);
+      int to = (int)(last % kHorizonSlots);
+      if (from < to) {
+        on[r.type].add(from, to, delta);
+      } else {
+        on[r.type].add(from, kHorizonSlots, delta);
+        on[r.type].add(0, to, delta);
+      }
+    }
+
+    int peakHeld(ParkingSpotType type, time_t start, time_t end) const {
+      int from = (int)(slotOf(start) % kHorizonSlots);
+      int to = (int)((slotOf(end - 1) + 1) % kHorizonSlots);
+      if (from < to) return timelines[type].maxIn(from, to);
+      return std::max(timelines[type].maxIn(from, kHorizonSlots), timelines[type].maxIn(0, to));
+    }
+
+    void remove(uint64_t id, const Reservation& r) {
+      hold(timelines, r, -1);
+      if (!r.checkedIn) hold(awaiting, r, -1);
+      reservations.erase(id);
+    }
+
+    // Caller holds the lock
+    void refresh(time_t now) {
+      while (!deadlines.empty() && deadlines.top().when <= now) {
+        Deadline due = deadlines.top();
+        deadlines.pop();
+        auto it = reservations.find(due.id);
+        if (it == reservations.end()) continue;  // cancelled already
+        Reservation& r = it->second;
+        if (r.checkedIn && due.when >= r.end) {
+          remove(due.id, r);
+        } else if (!r.checkedIn) {
+          forecaster->onReservationOutcome(false);
+          remove(due.id, r);
+        }
+      }
+      int slot = (int)(slotOf(now) % kHorizonSlots);
+      for (int type = 0; type < kSpotTypes; type++) {
+        outstanding[type].store(awaiting[type].maxIn(slot, slot + 1), std::memory_order_relaxed);
+      }
+      cachedSlot.store(slotOf(now), std::memory_order_release);
+    }
+
+  public:
+    ReservationEngine(OccupancyForecaster* forecaster)
+      : timelines(kSpotTypes, CapacityTimeline(kHorizonSlots)),
+        awaiting(kSpotTypes, CapacityTimeline(kHorizonSlots)), forecaster(forecaster) {
+      for (int type = 0; type < kSpotTypes; type++) outstanding[type].store(0);
+    }
+
+    void setCapacity(ParkingSpotType type, int spots) {
+      std::lock_guard<std::mutex> guard(lock);
+      capacity[type] = spots;
+    }
+
+    // Returns a reservation id, or 0 if the window is invalid or has no capacity left
+    uint64_t reserve(ParkingSpotType type, time_t start, time_t end, time_t now) {
+      std::lock_guard<std::mutex> guard(lock);
+      refresh(now);
+      if (start < now || end <= start || slotOf(end) - slotOf(now) >= kHorizonSlots) {
+        return 0;
+      }
+      int limit = forecaster->reservableCapacity(type, start, end, capacity[type]);
+      if (peakHeld(type, start, end) + 1 > limit) {
+        return 0;
+      }
+      uint64_t id = nextId++;
+      Reservation r = {type, start, end, false};
+      reservations[id] = r;
+      hold(timelines, r, +1);
+      hold(awaiting, r, +1);
+      deadlines.push(Deadline{start + kGraceSeconds, id});
+      refresh(now);
+      return id;
+    }
+
+    bool cancel(uint64_t id, time_t now) {
+      std::lock_guard<std::mutex> guard(lock);
+      auto it = reservations.find(id);
+      if (it == reservations.end()) return false;
+      remove(id, it->second);
+      refresh(now);
+      return true;
+    }
+
+    // The guest arrived at a gate; valid from one grace period before the start
+    bool checkIn(uint64_t id, ParkingSpotType type, time_t now) {
+      std::lock_guard<std::mutex> guard(lock);
+      refresh(now);
+      auto it = reservations.find(id);
+      if (it == reservations.end()) return false;
+      Reservation& r = it->second;
+      if (r.checkedIn || r.type != type || now < r.start - kGraceSeconds) return false;
+      r.checkedIn = true;
+      hold(awaiting, r, -1);
+      forecaster->onReservationOutcome(true);
+      deadlines.push(Deadline{r.end, id});
+      refresh(now);
+      return true;
+    }
+
+    // Rolls back checkIn() when the gate could not issue a ticket after all, so the
+    // guest can try again. Deadlines already queued still expire the hold as a no-show.
+    void undoCheckIn(uint64_t id, time_t now) {
+      std::lock_guard<std::mutex> guard(lock);
+      auto it = reservations.find(id);
+      if (it == reservations.end() || !it->second.checkedIn) return;
+      it->second.checkedIn = false;
+      hold(awaiting, it->second, +1);
+      forecaster->retractShow();
+      refresh(now);
+    }
+
+    // Spots that must stay free for guests due now who have not arrived yet.
+    // Lock-free unless this is the first call in a new slot.
+    int outstandingNow(ParkingSpotType type, time_t now) {
+      if (cachedSlot.load(std::memory_order_acquire) != slotOf(now)) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (cachedSlot.load(std::memory_order_relaxed) != slotOf(now)) refresh(now);
+      }
+      return outstanding[type].load(std::memory_order_relaxed);
+    }
 };
 
 // Payment is an abstract class
@@ -223,18 +1311,178 @@ class Payment {
         PaymentStatus status;
         time_t timestamp;
 
-    public virtual bool initiateTransaction() = 0;
+    public:
+        virtual ~Payment() {}
+        virtual bool initiateTransaction() = 0;
 };
 
 class Cash : public Payment {
-    public bool initiateTransaction() {
-        // definition
-    }
+    public:
+        bool initiateTransaction() {
+            // definition
+            return false;
+        }
 };
 
 class CreditCard : public Payment {
-    public bool initiateTransaction() {
-        // definition
+    public:
+        bool initiateTransaction() {
+            // definition
+            return false;
+        }
+};
+
+struct AuthorizationRequest {
+    uint64_t ticketNo;
+    string accountId;
+    double amount;
+    // Set only when a gate is holding the barrier until the answer comes back
+    std::shared_ptr<std::promise<bool>> result;
+    bool approved;
+};
+
+// Stand-in for the card processor; authorizes a whole batch in one round trip
+class PaymentProcessor {
+    public:
+        virtual ~PaymentProcessor() {}
+        // Sets `approved` on every request in the batch
+        virtual void authorizeBatch(vector<AuthorizationRequest>& batch) = 0;
+};
+
+// Local processor with a configurable round-trip latency and decline rate,
+// used to measure how many vehicles the exit gates can let out
+class MockPaymentProcessor : public PaymentProcessor {
+    private:
+        std::chrono::microseconds latency;
+        double declineRate;
+        std::mt19937 rng{7};
+
+    public:
+        MockPaymentProcessor(std::chrono::microseconds latency, double declineRate = 0.0)
+            : latency(latency), declineRate(declineRate) {}
+
+        void authorizeBatch(vector<AuthorizationRequest>& batch) override {
+            std::this_thread::sleep_for(latency);
+            std::uniform_real_distribution<double> draw(0.0, 1.0);
+            for (AuthorizationRequest& request : batch) request.approved = draw(rng) >= declineRate;
+        }
+};
+
+// Exits enqueue authorizations here instead of talking to the processor inline.
+// A single worker drains the queue in batches of up to maxBatch, waiting at most
+// maxWait for a batch to fill. Pre-authorized accounts leave before their answer
+// arrives; if such an authorization is declined, the ticket goes on the unpaid list
+// to be followed up.
+class SettlementPipeline {
+    private:
+        PaymentProcessor* processor;
+        size_t maxBatch;
+        std::chrono::microseconds maxWait;
+
+        std::mutex lock;
+        std::condition_variable ready;
+        std::deque<AuthorizationRequest> pending;
+        vector<uint64_t> unpaid;
+        bool stopping = false;
+
+        std::mutex accountsLock;
+        std::unordered_set<string> preAuthorized;
+
+        std::atomic<long long> approvedCount{0};
+        std::atomic<long long> declinedCount{0};
+        std::atomic<long long> batchCount{0};
+
+        std::thread worker;
+
+        void run() {
+            vector<AuthorizationRequest> batch;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    ready.wait(guard, [this] { return stopping || !pending.empty(); });
+                    if (pending.empty()) return;  // stopping and drained
+                    ready.wait_for(guard, maxWait, [this] { return stopping || pending.size() >= maxBatch; });
+                    size_t take = std::min(maxBatch, pending.size());
+                    batch.assign(std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.begin() + take));
+                    pending.erase(pending.begin(), pending.begin() + take);
+                }
+                processor->authorizeBatch(batch);
+                batchCount.fetch_add(1, std::memory_order_relaxed);
+                vector<uint64_t> declinedOptimistic;
+                for (AuthorizationRequest& request : batch) {
+                    (request.approved ? approvedCount : declinedCount).fetch_add(1, std::memory_order_relaxed);
+                    if (request.result) {
+                        request.result->set_value(request.approved);
+                    } else if (!request.approved) {
+                        declinedOptimistic.push_back(request.ticketNo);
+                    }
+                }
+                if (!declinedOptimistic.empty()) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    unpaid.insert(unpaid.end(), declinedOptimistic.begin(), declinedOptimistic.end());
+                }
+            }
+        }
+
+    public:
+        SettlementPipeline(PaymentProcessor* processor, size_t maxBatch = 64,
+                           std::chrono::microseconds maxWait = std::chrono::microseconds(1000))
+            : processor(processor), maxBatch(maxBatch), maxWait(maxWait) {
+            worker = std::thread([this] { run(); });
+        }
+
+        ~SettlementPipeline() { shutdown(); }
+
+        // Settles everything still queued and stops the worker, after which the counters
+        // are final. Nothing may be enqueued afterwards.
+        void shutdown() {
+            if (!worker.joinable()) return;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            ready.notify_all();
+            worker.join();
+        }
+
+        void addPreAuthorizedAccount(const string& accountId) {
+            std::lock_guard<std::mutex> guard(accountsLock);
+            preAuthorized.insert(accountId);
+        }
+
+        bool isPreAuthorized(const string& accountId) {
+            std::lock_guard<std::mutex> guard(accountsLock);
+            return preAuthorized.count(accountId) > 0;
+        }
+
+        void enqueue(AuthorizationRequest request) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                pending.push_back(std::move(request));
+            }
+            ready.notify_one();
+        }
+
+        // Tickets whose vehicle already left but whose payment was declined
+        vector<uint64_t> takeUnpaid() {
+            std::lock_guard<std::mutex> guard(lock);
+            vector<uint64_t> result;
+            result.swap(unpaid);
+            return result;
+        }
+
+        long long getApproved() const { return approvedCount.load(); }
+        long long getDeclined() const { return declinedCount.load(); }
+        long long getBatches() const { return batchCount.load(); }
+};
+
+// Where a lot is in the city, in km on a local grid
+struct GeoPoint {
+    double x = 0;
+    double y = 0;
+
+    static double distance(const GeoPoint& a, const GeoPoint& b) {
+        return std::hypot(a.x - b.x, a.y - b.y);
     }
 };
 
@@ -243,107 +1491,679 @@ class ParkingLot {
         int id;
         string name;
         string address;
+        GeoPoint position;
         ParkingRate parkingRate;
 
-        map<string, Entrance> entrance;
-        map<string, Exit> exit;
+        // All spots and entrances are registered before the gates open, claims after that are lock-free
+        vector<ParkingSpot*> spots;
+        vector<Entrance*> gates;
+        NearestSpotAllocator allocator;
+        FreeSpotCounters freeSpots;
+        ParkingRateEngine rates;
+
+        // Reservations hold capacity ahead of arrival; the forecaster learns from every ticket
+        OccupancyForecaster forecaster;
+        ReservationEngine reservations{&forecaster};
 
-        // Create a hashmap that identifies all currently generated tickets using their ticket number
-        map<string, ParkingTicket> tickets;
+        // Identifies all currently generated tickets using their ticket number
+        ShardedTicketTable tickets;
+        PlateIndex plates;
 
-        // The ParkingLot is a singleton class that ensures it will have only one active instance at a time
-        // Both the Entrance and Exit classes use this class to create and close parking tickets
-        static ParkingLot parkingLot = NULL;
+        // Entrances take blocks of ticket numbers from this counter, or from the store's once attached
+        std::atomic<uint64_t> nextTicketNo{1};
+        std::atomic<uint64_t>* ticketCounter = &nextTicketNo;
+
+        // Optional, keeps tickets and occupancy across restarts
+        TicketStore store;
 
         // Created a private constructor to add a restriction (due to Singleton)
-        ParkingLot() {
+        ParkingLot() : id(0) {
             // Call the name, address and parking_rate 
-            // Create initial entrance and exit hashmaps respectively
+            // Entrances are registered with addGate(), exits are given the lot directly
         }
 
+        // Further lots are only created through the registry, each with its own isolated state
+        ParkingLot(int id, string name, GeoPoint position) : id(id), name(name), position(position) {}
+        friend class ParkingLotRegistry;
+
     // Created a static method to access the singleton instance of ParkingLot
+    // The ParkingLot is a singleton class that ensures it will have only one active instance at a time
+    // Both the Entrance and Exit classes use this class to create and close parking tickets
+    // Deployments running several garages create them through ParkingLotRegistry instead
     public:
-        static ParkingLot getInstance() {
-            if (parkingLot == NULL) {
-                parkingLot = new ParkingLot();
-            }
+        static ParkingLot& getInstance() {
+            // Function-local static, so concurrent first calls from several gates are safe
+            static ParkingLot parkingLot;
             return parkingLot;
         }
 
-        bool addEntrance(Entrance entrance) {}
-        bool addExit(Exit exit) {}
+        // Spots are owned by the lot once added
+        ~ParkingLot() {
+            for (ParkingSpot* spot : spots) delete spot;
+        }
+
+        bool addParkingSpot(ParkingSpot* spot) {
+            spot->setIndex((int)spots.size());
+            spots.push_back(spot);
+            return true;
+        }
+
+        // Maps the ticket store and restores every ticket that was active when the lot went down.
+        // Call after all spots are added and before open(), which then builds the free lists
+        // from the restored occupancy.
+        bool attachStore(const string& path) {
+            if (!store.open(path, (uint32_t)spots.size())) {
+                return false;
+            }
+            for (ParkingSpot* spot : spots) {
+                const SpotRecord& rec = store.record(spot->getIndex());
+                if (rec.occupied.load(std::memory_order_acquire) && spot->tryClaim()) {
+                    tickets.insert(new ParkingTicket(rec.ticketNo, spot, rec.plate, (time_t)rec.entryTime));
+                    plates.tryInsert(rec.plate, PlateEntry{rec.ticketNo, spot});
+                }
+            }
+            ticketCounter = &store.ticketCounter();
+            return true;
+        }
+
+        int getId() const { return id; }
+        const GeoPoint& getPosition() const { return position; }
+
+        bool addGate(Entrance* entrance) {
+            entrance->setParkingLot(this);
+            gates.push_back(entrance);
+            return true;
+        }
+
+        // Pre-sorts every entrance's view of the spots, call once all spots and gates are added
+        // and seeds the free counters the display boards read
+        void open() {
+            allocator.build(spots, gates);
+            int levels = 0;
+            for (ParkingSpot* spot : spots) levels = std::max(levels, spot->getLocation().level + 1);
+            freeSpots.reset(levels);
+            int spotsOfType[kSpotTypes] = {0};
+            for (ParkingSpot* spot : spots) {
+                spotsOfType[spot->getType()]++;
+                if (spot->isFree()) freeSpots.onRelease(spot->getLocation().level, spot->getType());
+            }
+            for (int type = 0; type < kSpotTypes; type++) {
+                reservations.setCapacity((ParkingSpotType)type, spotsOfType[type]);
+            }
+        }
 
+        ParkingRateEngine& getRateEngine() { return rates; }
+        const FreeSpotCounters* getFreeSpotCounters() const { return &freeSpots; }
+        FreeSpotCounters* getFreeSpotCounters() { return &freeSpots; }
+
+        // Claims the free spot of the given type nearest to the entrance, without taking any lock
+        ParkingSpot* claimSpot(ParkingSpotType type, Entrance* entrance) {
+            ParkingSpot* spot = allocator.claimNearest(type, entrance);
+            if (spot != nullptr) freeSpots.onClaim(spot->getLocation().level, type);
+            return spot;
+        }
+
+        void releaseSpot(ParkingSpot* spot) {
+            spot->removeVehicle();
+            allocator.release(spot);
+            freeSpots.onRelease(spot->getLocation().level, spot->getType());
+        }
+
+    private:
+        ParkingTicket* issueTicket(Vehicle* vehicle, Entrance* entrance) {
+            ParkingSpot* spot = claimSpot(vehicle->getSpotType(), entrance);
+            if (spot == nullptr) {
+                return nullptr;
+            }
+            uint64_t ticketNo = entrance->getTicketNumbers().nextNumber(*ticketCounter);
+            string plate = PlateIndex::normalize(vehicle->getLicenseNo());
+            if (!plates.tryInsert(plate, PlateEntry{ticketNo, spot})) {
+                releaseSpot(spot);
+                return nullptr;
+            }
+            ParkingTicket* ticket = new ParkingTicket(ticketNo, spot, plate, time(nullptr));
+            tickets.insert(ticket);
+            if (store.isOpen()) {
+                store.recordIssue(spot->getIndex(), ticketNo, plate, ticket->getTimestamp());
+            }
+            forecaster.onArrival(spot->getType(), ticket->getTimestamp());
+            return ticket;
+        }
+
+    public:
         // This function allows parking tickets to be available at multiple entrances
-        ParkingTicket getParkingTicket(Vehicle vehicle) {}
+        // Every gate uses its own number range, so entrances issue tickets in parallel
+        // Returns nullptr if the lot is full, the remaining spots are held for reservations,
+        // or the plate already has an active ticket
+        ParkingTicket* getParkingTicket(Vehicle* vehicle, Entrance* entrance) {
+            ParkingSpotType type = vehicle->getSpotType();
+            if (freeSpots.total(type) <= reservations.outstandingNow(type, time(nullptr))) {
+                return nullptr;
+            }
+            return issueTicket(vehicle, entrance);
+        }
+
+        // A guest with a reservation, allowed to use the spots held back from walk-ins
+        ParkingTicket* getReservedTicket(Vehicle* vehicle, Entrance* entrance, uint64_t reservationId) {
+            if (!reservations.checkIn(reservationId, vehicle->getSpotType(), time(nullptr))) {
+                return nullptr;
+            }
+            ParkingTicket* ticket = issueTicket(vehicle, entrance);
+            if (ticket == nullptr) {
+                // No spot left or the plate is already parked, keep the reservation open
+                reservations.undoCheckIn(reservationId, time(nullptr));
+            }
+            return ticket;
+        }
+
+        // Returns a reservation id, or 0 if the window cannot be held
+        uint64_t reserve(ParkingSpotType type, time_t start, time_t end) {
+            return reservations.reserve(type, start, end, time(nullptr));
+        }
+
+        bool cancelReservation(uint64_t reservationId) {
+            return reservations.cancel(reservationId, time(nullptr));
+        }
+
+        // Removes the ticket under its shard lock and hands it to the caller. When the same
+        // ticket is scanned at two exits at once, only one of them gets it.
+        ParkingTicket* takeTicket(uint64_t ticketNo) { return tickets.remove(ticketNo); }
+
+        // Puts back a ticket taken by an exit that did not let the vehicle out
+        void returnTicket(ParkingTicket* ticket) { tickets.insert(ticket); }
+
+        // Frees the spot of a taken ticket for the next vehicle and deletes the ticket
+        void closeTakenTicket(ParkingTicket* ticket) {
+            ParkingSpot* spot = ticket->getSpot();
+            time_t now = time(nullptr);
+            if (store.isOpen()) {
+                store.recordClose(spot->getIndex(), ticket->getTicketNo(), now);
+            }
+            forecaster.onDeparture(spot->getType(), ticket->getTimestamp(), now);
+            plates.remove(ticket->getPlate());
+            releaseSpot(spot);
+            delete ticket;
+        }
+
+        // Called once the ticket is settled, frees the spot for the next vehicle
+        bool closeTicket(uint64_t ticketNo) {
+            ParkingTicket* ticket = takeTicket(ticketNo);
+            if (ticket == nullptr) {
+                return false;
+            }
+            closeTakenTicket(ticket);
+            return true;
+        }
+
+        ParkingTicket* getTicket(uint64_t ticketNo) { return tickets.find(ticketNo); }
+
+        // Lost tickets and enforcement: the active ticket for a plate as typed or read by a camera
+        PlateEntry findByPlate(const string& licenseNo) { return plates.find(PlateIndex::normalize(licenseNo)); }
+
+        // ANPR ingest, plates must already be normalized
+        void findByPlates(const vector<string>& normalizedPlates, vector<PlateEntry>& results) {
+            plates.findBatch(normalizedPlates, results);
+        }
+
+        bool isFull(ParkingSpotType type) { return freeSpots.total(type) <= 0; }
+};
+
+// Runs many lots in one process and routes arriving vehicles between them.
+// Lots are bucketed into square city areas; every area keeps a free count per spot
+// type that its lots' counters feed directly. Routing walks areas in rings around
+// the vehicle, skipping any area without capacity after a single atomic load, and
+// only looks at individual lots inside areas that have room.
+class ParkingLotRegistry {
+    private:
+        struct Area {
+            vector<ParkingLot*> lots;
+            std::atomic<int> free[kSpotTypes];
+
+            Area() {
+                for (int type = 0; type < kSpotTypes; type++) free[type].store(0, std::memory_order_relaxed);
+            }
+        };
+
+        double areaSize;
+        std::unordered_map<int, std::unique_ptr<ParkingLot>> lots;
+        std::unordered_map<int64_t, std::unique_ptr<Area>> areas;
+        int minCol = 0, maxCol = -1, minRow = 0, maxRow = -1;
+
+        ParkingLotRegistry(double areaSizeKm = 2.0) : areaSize(areaSizeKm) {}
+
+        int cellOf(double coordinate) const { return (int)std::floor(coordinate / areaSize); }
+        static int64_t areaKey(int col, int row) { return ((int64_t)col << 32) | (uint32_t)row; }
+
+        Area* findArea(int col, int row) const {
+            auto it = areas.find(areaKey(col, row));
+            return it == areas.end() ? nullptr : it->second.get();
+        }
+
+    public:
+        static ParkingLotRegistry& getInstance() {
+            static ParkingLotRegistry registry;
+            return registry;
+        }
+
+        // Returns an empty lot to be set up with spots and gates, or nullptr if the id is taken
+        ParkingLot* createLot(int id, string name, GeoPoint position) {
+            if (lots.count(id)) {
+                return nullptr;
+            }
+            ParkingLot* lot = new ParkingLot(id, name, position);
+            lots[id].reset(lot);
+            return lot;
+        }
+
+        // Destroys a lot that was never published, such as one built for a simulation run
+        bool removeLot(int id) {
+            auto it = lots.find(id);
+            if (it == lots.end()) {
+                return false;
+            }
+            for (auto& area : areas) {
+                for (ParkingLot* lot : area.second->lots) {
+                    if (lot == it->second.get()) return false;
+                }
+            }
+            lots.erase(it);
+            return true;
+        }
+
+        ParkingLot* getLot(int id) {
+            auto it = lots.find(id);
+            return it == lots.end() ? nullptr : it->second.get();
+        }
+
+        // Makes an opened lot visible to routing. Lots are published before traffic starts;
+        // from then on their claims and releases keep the area counters current.
+        bool publish(ParkingLot* lot) {
+            int col = cellOf(lot->getPosition().x);
+            int row = cellOf(lot->getPosition().y);
+            std::unique_ptr<Area>& area = areas[areaKey(col, row)];
+            if (!area) area.reset(new Area());
+            area->lots.push_back(lot);
+            lot->getFreeSpotCounters()->attachParent(area->free);
+            if (maxCol < minCol) {
+                minCol = maxCol = col;
+                minRow = maxRow = row;
+            } else {
+                minCol = std::min(minCol, col);
+                maxCol = std::max(maxCol, col);
+                minRow = std::min(minRow, row);
+                maxRow = std::max(maxRow, row);
+            }
+            return true;
+        }
 
-        bool isFull(ParkingSpot type) {}
+        // Nearest lot that currently has a free spot of the type, or nullptr if the city is full
+        ParkingLot* route(const GeoPoint& from, ParkingSpotType type) const {
+            int col = cellOf(from.x);
+            int row = cellOf(from.y);
+            int maxRing = std::max(std::max(std::abs(col - minCol), std::abs(col - maxCol)),
+                                   std::max(std::abs(row - minRow), std::abs(row - maxRow)));
+            ParkingLot* best = nullptr;
+            double bestDistance = 0;
+            for (int ring = 0; ring <= maxRing; ring++) {
+                for (int c = col - ring; c <= col + ring; c++) {
+                    for (int r = row - ring; r <= row + ring; r++) {
+                        // Only the cells on the ring's border, the inside was covered already
+                        if (std::abs(c - col) != ring && std::abs(r - row) != ring) continue;
+                        Area* area = findArea(c, r);
+                        if (area == nullptr || area->free[type].load(std::memory_order_relaxed) <= 0) continue;
+                        for (ParkingLot* lot : area->lots) {
+                            if (lot->isFull(type)) continue;
+                            double distance = GeoPoint::distance(from, lot->getPosition());
+                            if (best == nullptr || distance < bestDistance) {
+                                best = lot;
+                                bestDistance = distance;
+                            }
+                        }
+                    }
+                }
+                // Anything in the next ring is at least `ring` areas away
+                if (best != nullptr && bestDistance <= ring * areaSize) break;
+            }
+            return best;
+        }
 };
 
+ParkingTicket* Entrance::getTicket(Vehicle* vehicle) {
+    ParkingLot& parkingLot = lot ? *lot : ParkingLot::getInstance();
+    return parkingLot.getParkingTicket(vehicle, this);
+}
+
+bool Exit::validateTicket(uint64_t ticketNo, const string& accountId, time_t exitTime) {
+    // Owned by this exit from here on, so no other exit can price or charge it
+    ParkingTicket* ticket = lot->takeTicket(ticketNo);
+    if (ticket == nullptr) {
+        return false;
+    }
+    double fee = lot->getRateEngine().price(ticket->getSpot()->getType(), ticket->getTimestamp(), exitTime);
+    AuthorizationRequest request = {ticketNo, accountId, fee, nullptr, false};
+
+    // Pre-authorized accounts are let out right away and settled in the background
+    if (fee <= 0 || settlement->isPreAuthorized(accountId)) {
+        if (fee > 0) settlement->enqueue(std::move(request));
+        lot->closeTakenTicket(ticket);
+        return true;
+    }
+
+    // Everyone else waits for their authorization, which still rides in a batch
+    request.result = std::make_shared<std::promise<bool>>();
+    std::future<bool> approved = request.result->get_future();
+    settlement->enqueue(std::move(request));
+    if (!approved.get()) {
+        // The vehicle stays, and the ticket can be presented again
+        lot->returnTicket(ticket);
+        return false;
+    }
+    lot->closeTakenTicket(ticket);
+    return true;
+}
+
 class CarRateCalculator : public IRateCalculator {
     vector<RateSlab> slabs = {
         {1, 20.0},
         {3, 15.0},
         {INT_MAX, 10.0}
     };
+    // Built once from the slabs above, pricing is then a lookup instead of a walk
+    SlabTariff tariff{slabs};
 
 public:
     double calculateRate(int duration) override {
-        double total = 0;
-        int remainingHours = duration;
-        int previousLimit = 0;
+        return tariff.priceMinutes(duration * 60LL);
+    }
+};
 
-        for (auto& slab : slabs) {
-            int slabHours = std::min(remainingHours, slab.upToHour - previousLimit);
-            total += slabHours * slab.ratePerHour;
-            remainingHours -= slabHours;
-            previousLimit = slab.upToHour;
 
-            if (remainingHours <= 0) break;
-        }
-/*
+// Log-linear latency histogram: 16 sub-buckets per power of two (about 6% precision),
+// fixed memory however many samples are recorded
+class LatencyHistogram {
+  private:
+    static const int kSubBuckets = 16;
+    vector<uint64_t> counts = vector<uint64_t>(64 * kSubBuckets, 0);
+    uint64_t samples = 0;
+    uint64_t maxNs = 0;
 
-int previousLimit = 0;
+    static int bucketOf(uint64_t ns) {
+      if (ns < kSubBuckets) return (int)ns;
+      int shift = 63 - __builtin_clzll(ns) - 4;
+      return (shift + 1) * kSubBuckets + (int)((ns >> shift) - kSubBuckets);
+    }
 
-for (auto& slab : slabs) {
-    if (remainingHours <= 0) break;
+    static uint64_t lowerBoundOf(int bucket) {
+      if (bucket < kSubBuckets) return bucket;
+      int shift = bucket / kSubBuckets - 1;
+      return (uint64_t)(kSubBuckets + bucket % kSubBuckets) << shift;
+    }
 
-    int slabHours = slab.upToHour - previousLimit;
+  public:
+    void record(uint64_t ns) {
+      counts[bucketOf(ns)]++;
+      samples++;
+      maxNs = std::max(maxNs, ns);
+    }
 
-    if (remainingHours >= slabHours) {
-        total += slabHours * slab.ratePerHour;
-        remainingHours -= slabHours;
-    } else {
-        total += remainingHours * slab.ratePerHour;
-        remainingHours = 0;
+    void merge(const LatencyHistogram& other) {
+      for (size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+      samples += other.samples;
+      maxNs = std::max(maxNs, other.maxNs);
     }
 
-    previousLimit = slab.upToHour;
-}
+    uint64_t count() const { return samples; }
+    uint64_t max() const { return maxNs; }
+
+    uint64_t percentile(double p) const {
+      uint64_t rank = (uint64_t)std::ceil(p / 100.0 * samples);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank && counts[i] > 0) return lowerBoundOf((int)i);
+      }
+      return maxNs;
+    }
+};
 
+struct SimulationConfig {
+    int gates = 10;                  // one thread per entrance
+    long long events = 1000000;      // arrivals plus exits, over all gates
+    double arrivalsPerHour = 4000;   // for the whole lot, Poisson
+    double meanStayHours = 2.0;      // exponential
+    int levels = 5;
+    int spots[kSpotTypes] = {200, 6000, 1500, 800};
+    int vehicleMix[4] = {70, 10, 5, 15};  // car, van, truck, motorcycle
+    int preAuthorizedPercent = 90;   // exits that leave before their payment settles
+    int processorLatencyMicros = 500;  // mock card processor round trip per batch
+    uint64_t seed = 42;
+};
+
+// Drives arrival and exit events through the spot allocator, ticketing and the rate
+// calculator of a fresh lot, one thread per gate, and reports per-operation latency
+// percentiles and sustained throughput. Time inside the simulation is virtual: stays
+// are priced from their simulated length, the wall clock only measures the calls.
+class ParkingSimulator {
+  private:
+    struct Stats {
+      LatencyHistogram issue;
+      LatencyHistogram exit;
+      LatencyHistogram price;
+      long long rejected = 0;
+      double revenue = 0;
+    };
+
+    struct Parked {
+      double departure;
+      double arrival;
+      uint64_t ticketNo;
+      time_t issuedAt;
+      bool preAuthorized;
+      bool operator>(const Parked& other) const { return departure > other.departure; }
+    };
+
+    SimulationConfig config;
+    ParkingLot* lot = nullptr;
+    vector<Entrance*> gates;
+    vector<Exit*> exits;
+    CarRateCalculator calculator;
+    std::unique_ptr<MockPaymentProcessor> processor;
+    std::unique_ptr<SettlementPipeline> settlement;
+
+    static uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+      return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static std::unique_ptr<Vehicle> makeVehicle(int kind, const string& plate) {
+      switch (kind) {
+        case 0: return std::unique_ptr<Vehicle>(new Car(plate));
+        case 1: return std::unique_ptr<Vehicle>(new Van(plate));
+        case 2: return std::unique_ptr<Vehicle>(new Truck(plate));
+        default: return std::unique_ptr<Vehicle>(new MotorCycle(plate));
+      }
+    }
+
+    void setUp() {
+      static int nextLotId = 1000000;
+      lot = ParkingLotRegistry::getInstance().createLot(nextLotId++, "simulation", GeoPoint());
+      int id = 0;
+      for (int type = 0; type < kSpotTypes; type++) {
+        for (int i = 0; i < config.spots[type]; i++, id++) {
+          SpotLocation location;
+          location.level = id % config.levels;
+          location.x = (id / config.levels) % 100;
+          location.y = id / (config.levels * 100);
+          switch (type) {
+            case HANDICAPPED: lot->addParkingSpot(new Handicapped(id, location)); break;
+            case COMPACT: lot->addParkingSpot(new Compact(id, location)); break;
+            case LARGE: lot->addParkingSpot(new Large(id, location)); break;
+            default: lot->addParkingSpot(new Motorcycle(id, location)); break;
+          }
+        }
+      }
+      processor.reset(new MockPaymentProcessor(std::chrono::microseconds(config.processorLatencyMicros)));
+      settlement.reset(new SettlementPipeline(processor.get()));
+      settlement->addPreAuthorizedAccount("PREPAID");
+      for (int g = 0; g < config.gates; g++) {
+        SpotLocation location;
+        location.x = g * 100 / config.gates;
+        gates.push_back(new Entrance(g, location));
+        lot->addGate(gates.back());
+        exits.push_back(new Exit(g, lot, settlement.get()));
+      }
+      for (int type = 0; type < kSpotTypes; type++) {
+        lot->getRateEngine().setSlabs((ParkingSpotType)type, {{1, 20.0}, {3, 15.0}, {INT_MAX, 10.0}});
+      }
+      lot->open();
+    }
 
-*/
+    void runGate(int gate, long long events, Stats& stats) {
+      std::mt19937_64 rng(config.seed + gate);
+      std::exponential_distribution<double> interArrival(config.arrivalsPerHour / config.gates / 3600.0);
+      std::exponential_distribution<double> stay(1.0 / (config.meanStayHours * 3600.0));
+      std::discrete_distribution<int> mix(config.vehicleMix, config.vehicleMix + 4);
+      std::uniform_int_distribution<int> percent(0, 99);
+      std::priority_queue<Parked, vector<Parked>, std::greater<Parked>> parked;
+      double clock = 0;
+      long long arrivals = 0;
 
-        return total;
+      for (long long e = 0; e < events; e++) {
+        // Exponential gaps are memoryless, so redrawing after an exit does not bias arrivals
+        double nextArrival = clock + interArrival(rng);
+        if (!parked.empty() && parked.top().departure <= nextArrival) {
+          Parked leaving = parked.top();
+          parked.pop();
+          clock = leaving.departure;
+          auto start = std::chrono::steady_clock::now();
+          stats.revenue += calculator.calculateRate((int)std::ceil((leaving.departure - leaving.arrival) / 3600.0));
+          stats.price.record(nanosSince(start));
+          // Ticket timestamps are wall-clock, so the exit is stamped with the simulated stay,
+          // rounded up so a stay of under a second is still charged and authorized
+          time_t exitTime = leaving.issuedAt + (time_t)std::ceil(leaving.departure - leaving.arrival);
+          start = std::chrono::steady_clock::now();
+          exits[gate]->validateTicket(leaving.ticketNo, leaving.preAuthorized ? "PREPAID" : "WALKUP", exitTime);
+          stats.exit.record(nanosSince(start));
+        } else {
+          clock = nextArrival;
+          std::unique_ptr<Vehicle> vehicle = makeVehicle(mix(rng), "SIM" + std::to_string(gate) + "X" + std::to_string(arrivals++));
+          auto start = std::chrono::steady_clock::now();
+          ParkingTicket* ticket = gates[gate]->getTicket(vehicle.get());
+          stats.issue.record(nanosSince(start));
+          if (ticket == nullptr) {
+            stats.rejected++;
+          } else {
+            bool preAuthorized = percent(rng) < config.preAuthorizedPercent;
+            parked.push(Parked{clock + stay(rng), clock, ticket->getTicketNo(), ticket->getTimestamp(), preAuthorized});
+          }
+        }
+      }
+      // Vehicles still parked when the gate's share of events is done leave untimed
+      for (; !parked.empty(); parked.pop()) lot->closeTicket(parked.top().ticketNo);
+    }
+
+    // Settles what is still queued, then frees the gates and the lot with its spots
+    void tearDown() {
+      settlement.reset();
+      processor.reset();
+      for (Exit* exit : exits) delete exit;
+      for (Entrance* gate : gates) delete gate;
+      exits.clear();
+      gates.clear();
+      ParkingLotRegistry::getInstance().removeLot(lot->getId());
+      lot = nullptr;
+    }
+
+    static void report(const char* name, const LatencyHistogram& h) {
+      cout << "  " << name << ": n=" << h.count() << " p50=" << h.percentile(50) << "ns p90=" << h.percentile(90)
+           << "ns p99=" << h.percentile(99) << "ns p99.9=" << h.percentile(99.9) << "ns max=" << h.max() << "ns" << endl;
+    }
+
+  public:
+    ParkingSimulator(SimulationConfig config) : config(config) {}
+
+    void run() {
+      setUp();
+      vector<Stats> stats(config.gates);
+      vector<std::thread> threads;
+      auto start = std::chrono::steady_clock::now();
+      for (int g = 0; g < config.gates; g++) {
+        long long share = config.events / config.gates + (g < config.events % config.gates ? 1 : 0);
+        threads.emplace_back([this, g, share, &stats] { runGate(g, share, stats[g]); });
+      }
+      for (std::thread& t : threads) t.join();
+      double seconds = nanosSince(start) / 1e9;
+      // Pre-authorized exits are still settling in the background
+      settlement->shutdown();
+
+      Stats total;
+      for (Stats& s : stats) {
+        total.issue.merge(s.issue);
+        total.exit.merge(s.exit);
+        total.price.merge(s.price);
+        total.rejected += s.rejected;
+        total.revenue += s.revenue;
+      }
+      cout << "Simulated " << config.events << " events on " << config.gates << " gates in " << seconds << "s ("
+           << (long long)(config.events / seconds) << " events/s)" << endl;
+      report("issue ticket", total.issue);
+      report("exit gate   ", total.exit);
+      report("price stay  ", total.price);
+      cout << "  rejected arrivals: " << total.rejected << ", revenue: " << total.revenue << endl;
+      cout << "  authorizations: " << settlement->getApproved() + settlement->getDeclined() << " in "
+           << settlement->getBatches() << " batches" << endl;
+      tearDown();
     }
 };
 
+int main(int argc, char* argv[]) {
+    // `--simulate [events]` runs the throughput benchmark instead of the walkthrough below
+    if (argc > 1 && string(argv[1]) == "--simulate") {
+        SimulationConfig config;
+        if (argc > 2) config.events = atoll(argv[2]);
+        ParkingSimulator(config).run();
+        return 0;
+    }
 
-int main() {
-    // Step 1: Setup entrance and register with ParkingLot
-    auto entrance = make_unique<Entrance>("E1");
-    ParkingLot::getInstance().addEntrance("E1", std::move(entrance));
+    // Step 1: Set up a lot with a few spots and one entrance, then open it for traffic
+    ParkingLot* lot = ParkingLotRegistry::getInstance().createLot(1, "Downtown", GeoPoint());
+    for (int id = 0; id < 4; id++) {
+        SpotLocation location;
+        location.x = id;
+        lot->addParkingSpot(new Compact(id, location));
+    }
+    lot->getRateEngine().setSlabs(COMPACT, {{1, 20.0}, {3, 15.0}, {INT_MAX, 10.0}});
+    Entrance entrance(1);
+    lot->addGate(&entrance);
+    lot->open();
+    ParkingLotRegistry::getInstance().publish(lot);
+    DisplayBoard board(1, -1, lot->getFreeSpotCounters());
 
     // Step 2: Vehicle arrives
-    Vehicle v("KA-01-AB-1234");
+    Car car("KA-01-AB-1234");
 
     // Step 3: Vehicle interacts with the entrance to get a ticket
-    Entrance* e = ParkingLot::getInstance().getEntrance("E1");
-    if (e) {
-        ParkingTicket ticket = e->getTicket(v);
-        cout << "Client: Received ticket number " << ticket.ticketNumber << endl;
+    ParkingTicket* ticket = entrance.getTicket(&car);
+    if (ticket == nullptr) {
+        cout << "Parking lot is full!" << endl;
+        return 0;
+    }
+    car.assignTicket(ticket);
+    cout << "Client: Received ticket number " << ticket->getTicketNo() << " for spot " << ticket->getSpot()->getId() << endl;
+    board.showFreeSlot();
+
+    // Step 4: Vehicle leaves after 90 minutes and pays at the exit
+    MockPaymentProcessor processor(std::chrono::microseconds(0));
+    SettlementPipeline settlement(&processor);
+    Exit exitGate(1, lot, &settlement);
+    time_t leaveAt = ticket->getTimestamp() + 90 * 60;
+    double fee = lot->getRateEngine().price(COMPACT, ticket->getTimestamp(), leaveAt);
+    if (exitGate.validateTicket(ticket->getTicketNo(), "WALKUP", leaveAt)) {
+        car.assignTicket(nullptr);
+        cout << "Client: Paid " << fee << " and left" << endl;
     } else {
-        cout << "Entrance not found!" << endl;
+        cout << "Client: Payment declined" << endl;
     }
+    board.showFreeSlot();
 
     return 0;
 }